@@ -0,0 +1,558 @@
+#include "gameEngine3D.h"
+#include "parallelObjLoader.h"
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <map>
+
+using namespace std;
+
+// Renders fixed camera paths over assets/mountains.obj and generated terrain of
+// growing size, headless, and reports frame time percentiles and the throughput
+// of each stage. Every frame is hashed, and the hash of each run is checked
+// against assets/benchmark_golden.txt so a faster renderer can be shown to draw
+// exactly the same images. Run from the Simple_Render directory, like the demo.
+
+const int nBenchmarkWidth = 256;
+const int nBenchmarkHeight = 240;
+
+// Hashes every frame it is given instead of showing it
+class benchmarkBackend : public olcHeadlessBackend
+{
+public:
+	benchmarkBackend(uint64_t nFrames) : olcHeadlessBackend(nFrames, false)
+	{
+	}
+
+	void Present(const CHAR_INFO* buf, int width, int height) override
+	{
+		olcHeadlessBackend::Present(buf, width, height);
+
+		// FNV-1a over the glyph and colour of each cell, then over the frame hashes
+		uint64_t nFrameHash = 14695981039346656037ull;
+		for (int i = 0; i < width * height; i++)
+		{
+			uint16_t nCell[2] = { (uint16_t)buf[i].Char.UnicodeChar, (uint16_t)buf[i].Attributes };
+			const uint8_t* p = (const uint8_t*)nCell;
+			for (int k = 0; k < 4; k++)
+				nFrameHash = (nFrameHash ^ p[k]) * 1099511628211ull;
+		}
+		for (int k = 0; k < 8; k++)
+			m_nHash = (m_nHash ^ ((nFrameHash >> (8 * k)) & 0xFF)) * 1099511628211ull;
+	}
+
+	uint64_t Hash() const
+	{
+		return m_nHash;
+	}
+
+private:
+	uint64_t m_nHash = 14695981039346656037ull;
+};
+
+struct benchmarkOptions
+{
+	uint64_t nFrames = 200;
+	int nThreads = 0;
+	bool bEdgeRasterizer = false;
+	vector<TRANSFORM_KERNEL> vecKernels; // Each run once per kernel, empty for the CPUID choice only
+	bool bTerrain = true;
+	bool bLoad = true;
+	string sGoldenFile = "assets/benchmark_golden.txt";
+	bool bUpdateGolden = false;
+};
+
+struct benchmarkResult
+{
+	string sKey;
+	string sLabel; // sKey, plus the kernel when comparing them
+	size_t nTriangles = 0;
+	vector<frameStats> vecFrames;
+	uint64_t nHash = 0;
+};
+
+// Direction the engine looks in for a yaw, with no pitch
+vec3d LookDirection(float fYaw)
+{
+	vec3d vForward = { 0.0f, 0.0f, 1.0f };
+	vec3d vLook;
+	mat4x4 matYaw = CreateRotationMatrixY(fYaw);
+	MultiplyVectorMatrix(vForward, vLook, matYaw);
+	return vLook;
+}
+
+// The paths assume a mesh about 160 units across and 35 high, centred on the
+// origin, as mountains.obj and the generated terrain are
+void BuildCameraPaths(map<string, cameraPath>& paths)
+{
+	// Straight in from one side, turning across the range
+	cameraPath& flyover = paths["flyover"];
+	flyover.Add({ 0.0f, 45.0f, -110.0f }, 0.0f, 0.35f);
+	flyover.Add({ 0.0f, 40.0f, -40.0f }, 0.3f, 0.35f);
+	flyover.Add({ 20.0f, 38.0f, 20.0f }, 1.2f, 0.3f);
+	flyover.Add({ 60.0f, 42.0f, 40.0f }, 2.4f, 0.3f);
+
+	// All the way round, always facing the centre
+	cameraPath& orbit = paths["orbit"];
+	const float fPi = 3.14159265f;
+	for (int k = 0; k <= 8; k++)
+	{
+		float fYaw = 2.0f * fPi * k / 8;
+		vec3d vLook = LookDirection(fYaw);
+		orbit.Add({ -110.0f * vLook.x, 50.0f, 2.0f - 110.0f * vLook.z }, fYaw, 0.35f);
+	}
+
+	// Low over the middle, looking around, with most triangles close enough to clip
+	cameraPath& ground = paths["ground"];
+	for (int k = 0; k <= 4; k++)
+		ground.Add({ 5.0f * k, 30.0f, 2.0f }, fPi * k / 2, 0.15f);
+}
+
+benchmarkResult RunBenchmark(const string& sName, const indexedMesh* pMesh, const cameraPath& path, const benchmarkOptions& opt)
+{
+	benchmarkBackend* pBackend = new benchmarkBackend(opt.nFrames);
+
+	gameEngine3D engine;
+	engine.SetBackend(unique_ptr<olcConsoleBackend>(pBackend));
+	engine.SetThreadCount(opt.nThreads);
+	engine.SetEdgeRasterizer(opt.bEdgeRasterizer);
+	if (pMesh)
+		engine.SetMesh(*pMesh);
+	engine.SetCameraPath(&path, opt.nFrames);
+	engine.EnableProfiler(true);
+	engine.Profiler().SetRecording(true);
+
+	benchmarkResult result;
+	if (engine.ConstructConsole(nBenchmarkWidth, nBenchmarkHeight, 4, 4))
+		engine.Start();
+
+	result.sKey = sName + "/" + (opt.bEdgeRasterizer ? "edge" : "scanline") + "/" + to_string(opt.nFrames);
+	result.sLabel = result.sKey;
+	if (!opt.vecKernels.empty())
+	{
+		wstring sKernel = GetTransformKernelName(ActiveTransformKernel());
+		result.sLabel += " " + string(sKernel.begin(), sKernel.end());
+	}
+	result.nTriangles = engine.TriangleCount();
+	result.vecFrames = engine.Profiler().Recorded();
+	result.nHash = pBackend->Hash();
+	return result;
+}
+
+// Value below which fPercent of the sorted values lie, nearest rank
+double Percentile(const vector<double>& vecSorted, double fPercent)
+{
+	if (vecSorted.empty())
+		return 0.0;
+	size_t n = (size_t)ceil(fPercent / 100.0 * vecSorted.size());
+	return vecSorted[n > 0 ? n - 1 : 0];
+}
+
+void PrintResult(const benchmarkResult& r, const char* sGolden)
+{
+	// The first frames fill caches and grow buffers, so they are left out of the timings
+	size_t nWarmup = min<size_t>(10, r.vecFrames.size() / 10);
+	vector<double> vecTimes;
+	frameStats total;
+	for (size_t i = nWarmup; i < r.vecFrames.size(); i++)
+	{
+		const frameStats& f = r.vecFrames[i];
+		vecTimes.push_back(1000.0 * f.dFrameTime);
+		total.dFrameTime += f.dFrameTime;
+		for (int s = 0; s < STAGE_COUNT; s++)
+			total.dStageTime[s] += f.dStageTime[s];
+		for (int c = 0; c < COUNTER_COUNT; c++)
+			total.nCounters[c] += f.nCounters[c];
+	}
+	sort(vecTimes.begin(), vecTimes.end());
+	double n = (double)max<size_t>(vecTimes.size(), 1);
+
+	printf("%-40s %8zu %8.3f %8.3f %8.3f %8.3f %8.3f  %016llx %s\n", r.sLabel.c_str(), r.nTriangles,
+		1000.0 * total.dFrameTime / n, Percentile(vecTimes, 50), Percentile(vecTimes, 90), Percentile(vecTimes, 99), vecTimes.empty() ? 0.0 : vecTimes.back(),
+		(unsigned long long)r.nHash, sGolden);
+
+	// Millions of items per second of time spent in the stage
+	auto Rate = [](uint64_t nItems, double dSeconds) { return dSeconds > 0.0 ? nItems / dSeconds / 1e6 : 0.0; };
+	printf("    transform %.3f ms %.1f Mverts/s, geometry %.3f ms %.1f Mtris/s, raster %.3f ms %.1f Mtris/s %.1f Mcells/s, clear %.3f ms\n",
+		1000.0 * total.dStageTime[STAGE_TRANSFORM] / n, Rate(total.nCounters[COUNTER_VERTICES], total.dStageTime[STAGE_TRANSFORM]),
+		1000.0 * total.dStageTime[STAGE_GEOMETRY] / n, Rate(total.nCounters[COUNTER_TRIANGLES], total.dStageTime[STAGE_GEOMETRY]),
+		1000.0 * total.dStageTime[STAGE_RASTER] / n, Rate(total.nCounters[COUNTER_RASTER], total.dStageTime[STAGE_RASTER]),
+		Rate(total.nCounters[COUNTER_CELLS], total.dStageTime[STAGE_RASTER]),
+		1000.0 * total.dStageTime[STAGE_CLEAR] / n);
+}
+
+// Writes the mesh out as an .obj, every other face with relative indices and one
+// face that refers to no vertex, so the parallel loader meets all the cases the
+// serial one handles
+bool WriteObjFile(const indexedMesh& m, const string& sFile)
+{
+	ofstream f(sFile, ios::trunc);
+	if (!f.is_open())
+		return false;
+	f << "# Generated by renderBenchmark\n";
+	char buf[96];
+	for (size_t v = 0; v < m.verts.size(); v++)
+	{
+		snprintf(buf, sizeof(buf), "v %.9g %.9g %.9g\n", m.verts.x[v], m.verts.y[v], m.verts.z[v]);
+		f << buf;
+	}
+	long long nVerts = (long long)m.verts.size();
+	for (size_t t = 0; t < m.TriangleCount(); t++)
+	{
+		long long a = m.indices[t * 3], b = m.indices[t * 3 + 1], c = m.indices[t * 3 + 2];
+		if (t % 2 == 0)
+			snprintf(buf, sizeof(buf), "f %lld %lld %lld\n", a + 1, b + 1, c + 1);
+		else
+			snprintf(buf, sizeof(buf), "f %lld %lld %lld\n", a - nVerts, b - nVerts, c - nVerts);
+		f << buf;
+		if (t == m.TriangleCount() / 2)
+			f << "f 1 2 0\n";
+	}
+	return f.good();
+}
+
+// Same vertices, triangles and counts, bit for bit
+bool SameLoad(const indexedMesh& a, const objLoadStats& sa, const indexedMesh& b, const objLoadStats& sb)
+{
+	return a.verts.x == b.verts.x && a.verts.y == b.verts.y && a.verts.z == b.verts.z && a.indices == b.indices &&
+		sa.nBytes == sb.nBytes && sa.nVertices == sb.nVertices && sa.nFaces == sb.nFaces &&
+		sa.nTriangles == sb.nTriangles && sa.nSkippedFaces == sb.nSkippedFaces;
+}
+
+// Best of a few loads, straight from the .obj and never through the cache. Every
+// parallel load must give the mesh the serial one did, and so must a load split
+// into small chunks over a few threads, which checks the split even on a machine
+// or a file where the timed loads fall back to the serial loader. False on any
+// difference.
+bool RunLoadBenchmark(const string& sFile, int nThreads)
+{
+	const int nRepeats = 5;
+	double dSerial = 0.0, dParallel = 0.0;
+	objLoadStats serialStats, parallelStats;
+	bool bSame = true;
+	workerPool pool(nThreads);
+	for (int i = 0; i < nRepeats; i++)
+	{
+		indexedMesh m;
+		if (!m.LoadFromObjFile(sFile, &serialStats))
+		{
+			printf("Could not load %s\n", sFile.c_str());
+			return false;
+		}
+		dSerial = i == 0 ? serialStats.dSeconds : min(dSerial, serialStats.dSeconds);
+
+		indexedMesh mp;
+		bSame = LoadObjFileParallel(mp, sFile, pool, &parallelStats) && SameLoad(m, serialStats, mp, parallelStats) && bSame;
+		dParallel = i == 0 ? parallelStats.dSeconds : min(dParallel, parallelStats.dSeconds);
+
+		if (i == 0)
+		{
+			workerPool splitPool(4);
+			indexedMesh ms;
+			objLoadStats splitStats;
+			size_t nChunkBytes = max<size_t>(serialStats.nBytes / 16, 1);
+			bSame = LoadObjFileParallel(ms, sFile, splitPool, &splitStats, nChunkBytes) && splitStats.nChunks > 1 &&
+				SameLoad(m, serialStats, ms, splitStats) && bSame;
+		}
+	}
+
+	size_t nBytes = serialStats.nBytes;
+	char sChunks[32] = "serial fallback";
+	if (parallelStats.nChunks > 1)
+		snprintf(sChunks, sizeof(sChunks), "%zu chunks", parallelStats.nChunks);
+	printf("load %s: %zu bytes, serial %.3f ms (%.1f MB/s), %d threads %.3f ms (%.1f MB/s, %s), %s\n", sFile.c_str(), nBytes,
+		1000.0 * dSerial, nBytes / dSerial / 1e6, pool.ThreadCount(), 1000.0 * dParallel, nBytes / dParallel / 1e6, sChunks,
+		bSame ? "same mesh" : "MISMATCH");
+	return bSame;
+}
+
+// Mixes one block and compares it with the exact sum expected. The samples and
+// volumes are small powers of two, so no sum is rounded.
+bool CheckMix(audioMixer& mixer, const char* sName, unsigned int nChannels, const vector<float>& vecExpected)
+{
+	vector<float> vecOut(vecExpected.size(), -1.0f);
+	mixer.Mix(vecOut.data(), (unsigned int)vecExpected.size() / nChannels, nChannels);
+	if (vecOut == vecExpected)
+		return true;
+
+	printf("audio %s: got", sName);
+	for (float f : vecOut)
+		printf(" %g", f);
+	printf(", expected");
+	for (float f : vecExpected)
+		printf(" %g", f);
+	printf("\n");
+	return false;
+}
+
+bool CheckCount(const char* sName, uint64_t nCount, uint64_t nExpected)
+{
+	if (nCount == nExpected)
+		return true;
+	printf("audio %s: got %llu, expected %llu\n", sName, (unsigned long long)nCount, (unsigned long long)nExpected);
+	return false;
+}
+
+// Drives audioMixer::Mix directly, with no sound device, and returns the number
+// of checks that failed
+int RunMixerChecks()
+{
+	const float fRamp[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	const float fFlat[8] = { 16, 16, 16, 16, 16, 16, 16, 16 };
+	const float fShort[3] = { 1, 2, 4 };
+	const float fStereo[4] = { 1, 8, 2, 16 };
+	const float fOne[1] = { 1 };
+	int nFailed = 0;
+	int nChecks = 0;
+	auto Check = [&](bool bOk) { nChecks++; nFailed += bOk ? 0 : 1; };
+
+	// Play, stop and stop all, with a voice that finishes at the end of a block
+	{
+		unique_ptr<audioMixer> pMixer(new audioMixer());
+		audioMixer& mixer = *pMixer;
+		int nRamp = mixer.AddSample(fRamp, 8, 1);
+		int nFlat = mixer.AddSample(fFlat, 8, 1);
+		Check(CheckCount("bad sample", mixer.AddSample(nullptr, 8, 1), 0));
+
+		mixer.Play(nRamp);
+		mixer.Play(99);
+		Check(CheckMix(mixer, "play", 1, { 1, 2, 3, 4 }));
+		mixer.Play(nFlat, false, 0.5f);
+		Check(CheckMix(mixer, "mix", 1, { 13, 14, 15, 16 }));
+		Check(CheckCount("voices after the end", mixer.Playing(), 1));
+		mixer.Stop(nFlat);
+		Check(CheckMix(mixer, "stop", 1, { 0, 0, 0, 0 }));
+		Check(CheckCount("voices after stop", mixer.Playing(), 0));
+
+		mixer.Play(nRamp);
+		mixer.Play(nFlat);
+		mixer.Play(nRamp);
+		Check(CheckMix(mixer, "three voices", 1, { 18, 20 }));
+		mixer.Stop(nRamp);
+		Check(CheckMix(mixer, "stop one sample", 1, { 16, 16 }));
+		mixer.Play(nRamp);
+		mixer.StopAll();
+		Check(CheckMix(mixer, "stop all", 1, { 0, 0 }));
+		Check(CheckCount("voices after stop all", mixer.Playing(), 0));
+	}
+
+	// A looping voice wrapping in the middle of blocks
+	{
+		unique_ptr<audioMixer> pMixer(new audioMixer());
+		audioMixer& mixer = *pMixer;
+		mixer.Play(mixer.AddSample(fShort, 3, 1), true);
+		Check(CheckMix(mixer, "loop", 1, { 1, 2, 4, 1, 2, 4, 1, 2 }));
+		Check(CheckMix(mixer, "loop across blocks", 1, { 4, 1, 2, 4 }));
+		Check(CheckCount("looping voices", mixer.Playing(), 1));
+	}
+
+	// Mono spread over stereo, stereo as is and stereo down to its left channel
+	{
+		unique_ptr<audioMixer> pMixer(new audioMixer());
+		audioMixer& mixer = *pMixer;
+		int nMono = mixer.AddSample(fShort, 3, 1);
+		int nStereo = mixer.AddSample(fStereo, 2, 2);
+		mixer.Play(nMono);
+		Check(CheckMix(mixer, "mono to stereo", 2, { 1, 1, 2, 2, 4, 4 }));
+		mixer.Play(nStereo, false, 0.5f);
+		Check(CheckMix(mixer, "stereo", 2, { 0.5f, 4, 1, 8 }));
+		mixer.Play(nStereo);
+		Check(CheckMix(mixer, "stereo to mono", 1, { 1, 2 }));
+	}
+
+	// More plays than voices, in two blocks as the command ring holds as many as there are voices
+	{
+		unique_ptr<audioMixer> pMixer(new audioMixer());
+		audioMixer& mixer = *pMixer;
+		int nOne = mixer.AddSample(fOne, 1, 1);
+		for (int i = 0; i < 200; i++)
+			mixer.Play(nOne, true);
+		Check(CheckMix(mixer, "200 voices", 1, { 200, 200 }));
+		for (size_t i = 200; i < audioMixer::nMaxVoices + 3; i++)
+			mixer.Play(nOne, true);
+		float fAll = (float)audioMixer::nMaxVoices;
+		Check(CheckMix(mixer, "every voice", 1, { fAll, fAll }));
+		Check(CheckCount("voices when full", mixer.Playing(), audioMixer::nMaxVoices));
+		Check(CheckCount("dropped voices", mixer.DroppedVoices(), 3));
+		Check(CheckCount("dropped commands without overflow", mixer.DroppedCommands(), 0));
+	}
+
+	// More commands than the ring holds before the audio thread takes any
+	{
+		unique_ptr<audioMixer> pMixer(new audioMixer());
+		audioMixer& mixer = *pMixer;
+		int nOne = mixer.AddSample(fOne, 1, 1);
+		size_t nRefused = 0;
+		for (size_t i = 0; i < audioMixer::nCommandCapacity + 5; i++)
+			nRefused += mixer.Play(nOne, true) ? 0 : 1;
+		Check(CheckCount("refused commands", nRefused, 5));
+		Check(CheckCount("dropped commands", mixer.DroppedCommands(), 5));
+		float fAll = (float)audioMixer::nCommandCapacity;
+		Check(CheckMix(mixer, "full ring", 1, { fAll, fAll }));
+		Check(CheckCount("ring usable again", mixer.Play(nOne) ? 1 : 0, 1));
+	}
+
+	printf("audio mixer: %d checks, %s\n\n", nChecks, nFailed == 0 ? "ok" : "MISMATCH");
+	return nFailed;
+}
+
+map<string, uint64_t> ReadGolden(const string& sFile)
+{
+	map<string, uint64_t> golden;
+	ifstream f(sFile);
+	string sLine;
+	while (getline(f, sLine))
+	{
+		if (sLine.empty() || sLine[0] == '#')
+			continue;
+		istringstream s(sLine);
+		string sKey, sHash;
+		if (s >> sKey >> sHash)
+			golden[sKey] = strtoull(sHash.c_str(), nullptr, 16);
+	}
+	return golden;
+}
+
+bool WriteGolden(const string& sFile, const map<string, uint64_t>& golden)
+{
+	ofstream f(sFile, ios::trunc);
+	if (!f.is_open())
+		return false;
+	f << "# Frame hashes of renderBenchmark runs: mesh/path/rasterizer/frames hash\n";
+	f << "# Regenerate with renderBenchmark --update-golden once a change to the image is intended\n";
+	char buf[32];
+	for (auto& g : golden)
+	{
+		snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)g.second);
+		f << g.first << " " << buf << "\n";
+	}
+	return f.good();
+}
+
+int main(int argc, char* argv[])
+{
+	benchmarkOptions opt;
+	for (int i = 1; i < argc; i++)
+	{
+		// --frames N per camera path, 200 by default
+		if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			opt.nFrames = strtoull(argv[++i], nullptr, 10);
+		// --threads N for the geometry and raster stages, 0 = one per hardware thread
+		if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			opt.nThreads = atoi(argv[++i]);
+		// --raster edge|scanline, each has its own golden hashes
+		if (strcmp(argv[i], "--raster") == 0 && i + 1 < argc)
+			opt.bEdgeRasterizer = strcmp(argv[++i], "edge") == 0;
+		// --kernel scalar|sse|avx|all, all running every kernel the CPU has. The
+		// kernels share golden hashes, so they must all draw the same frames.
+		if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc)
+		{
+			i++;
+			TRANSFORM_KERNEL best = GetBestTransformKernel();
+			for (TRANSFORM_KERNEL k : { TRANSFORM_SCALAR, TRANSFORM_SSE, TRANSFORM_AVX })
+			{
+				bool bAll = strcmp(argv[i], "all") == 0;
+				if ((bAll && k <= best) || (!bAll && strcmp(argv[i], k == TRANSFORM_SCALAR ? "scalar" : (k == TRANSFORM_SSE ? "sse" : "avx")) == 0))
+					opt.vecKernels.push_back(k);
+			}
+		}
+		// --quick leaves out the generated terrain and the load timings
+		if (strcmp(argv[i], "--quick") == 0)
+		{
+			opt.bTerrain = false;
+			opt.bLoad = false;
+		}
+		// --golden file to check against, --update-golden to record this run's hashes in it
+		if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc)
+			opt.sGoldenFile = argv[++i];
+		if (strcmp(argv[i], "--update-golden") == 0)
+			opt.bUpdateGolden = true;
+	}
+	if (opt.nFrames == 0)
+		opt.nFrames = 1;
+
+	int nMixerMismatches = RunMixerChecks();
+
+	// mountains.obj is too small to split, so a generated file of a few MB is
+	// loaded as well
+	int nLoadMismatches = 0;
+	if (opt.bLoad)
+	{
+		if (!RunLoadBenchmark("assets/mountains.obj", opt.nThreads))
+			nLoadMismatches++;
+
+		const string sTerrainFile = "assets/benchmark_terrain.obj";
+		if (!WriteObjFile(CreateTerrainMesh(256, 160.0f, 35.0f), sTerrainFile) || !RunLoadBenchmark(sTerrainFile, opt.nThreads))
+			nLoadMismatches++;
+		remove(sTerrainFile.c_str());
+		printf("\n");
+	}
+
+	map<string, cameraPath> paths;
+	BuildCameraPaths(paths);
+
+	// Generated meshes go from about the size of mountains.obj to over a hundred
+	// thousand triangles
+	vector<pair<string, indexedMesh>> vecMeshes;
+	if (opt.bTerrain)
+		for (int nCells : { 64, 128, 256 })
+			vecMeshes.push_back({ "terrain" + to_string(nCells), CreateTerrainMesh(nCells, 160.0f, 35.0f) });
+
+	map<string, uint64_t> golden = ReadGolden(opt.sGoldenFile);
+	int nMismatches = 0;
+
+	printf("%-40s %8s %8s %8s %8s %8s %8s  %-16s %s\n", "run", "tris", "mean", "p50", "p90", "p99", "max", "hash", "golden");
+	for (int nMesh = -1; nMesh < (int)vecMeshes.size(); nMesh++)
+	{
+		for (auto& path : paths)
+		{
+			size_t nRuns = max<size_t>(opt.vecKernels.size(), 1);
+			for (size_t nKernel = 0; nKernel < nRuns; nKernel++)
+			{
+				if (!opt.vecKernels.empty())
+					SetTransformKernel(opt.vecKernels[nKernel]);
+
+				string sMesh = nMesh < 0 ? "mountains" : vecMeshes[nMesh].first;
+				benchmarkResult r = RunBenchmark(sMesh + "/" + path.first, nMesh < 0 ? nullptr : &vecMeshes[nMesh].second, path.second, opt);
+
+				// A kernel after the first is also checked against the ones before it
+				const char* sGolden = "new";
+				auto it = golden.find(r.sKey);
+				if (it != golden.end())
+				{
+					sGolden = it->second == r.nHash ? "ok" : "MISMATCH";
+					if (it->second != r.nHash && !opt.bUpdateGolden)
+						nMismatches++;
+				}
+				PrintResult(r, sGolden);
+				golden[r.sKey] = r.nHash;
+			}
+		}
+	}
+
+	if (opt.bUpdateGolden)
+	{
+		if (WriteGolden(opt.sGoldenFile, golden))
+			printf("\nGolden hashes written to %s\n", opt.sGoldenFile.c_str());
+		else
+			printf("\nCould not write %s\n", opt.sGoldenFile.c_str());
+	}
+	else if (nMismatches > 0)
+	{
+		printf("\n%d runs drew different frames from the golden ones\n", nMismatches);
+		return 1;
+	}
+	if (nLoadMismatches > 0)
+	{
+		printf("\n%d files loaded differently in parallel\n", nLoadMismatches);
+		return 1;
+	}
+	if (nMixerMismatches > 0)
+	{
+		printf("\n%d audio mixer checks failed\n", nMixerMismatches);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,751 @@
+#pragma once
+
+#ifndef ANSI_TERMINAL_BACKEND_H
+#define ANSI_TERMINAL_BACKEND_H
+
+#ifndef _WIN32
+
+#include "consoleBackend.h"
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <csignal>
+#include <cerrno>
+#include <thread>
+#include <atomic>
+#include <cstring>
+#include <unistd.h>
+#include <termios.h>
+#include <poll.h>
+
+// Presents m_bufScreen on a VT100 compatible terminal. Rewriting all 61,440 cells
+// every frame would saturate a tty, so the backend keeps the last presented frame
+// and only emits runs of cells that changed. Colours are only re-sent when they
+// differ from what the terminal currently has selected, and the whole frame goes
+// out with a single write().
+//
+// Input is read from stdin on a thread of its own and queued as it arrives.
+// Terminals only report key presses, and keep repeating them while a key is
+// held, so a key counts as released once its repeats stop coming.
+class olcAnsiTerminalBackend : public olcConsoleBackend
+{
+public:
+	olcAnsiTerminalBackend(int fd = STDOUT_FILENO, bool bTrueColour = true)
+	{
+		m_fd = fd;
+		m_bTrueColour = bTrueColour;
+	}
+
+	~olcAnsiTerminalBackend()
+	{
+		RestoreTerminal();
+	}
+
+	bool Construct(int width, int height, int /*fontw*/, int /*fonth*/) override
+	{
+		m_nWidth = width;
+		m_nHeight = height;
+		m_vecPrevious.assign(width * height, CHAR_INFO());
+		m_bFullRedraw = true;
+
+		// Worst case per cell is a cursor move, both colours and a 3 byte glyph
+		m_sFrame.reserve(width * height * 48);
+
+		// Stop the terminal from echoing typed keys over the image
+		terminalState& state = TerminalState();
+		if (isatty(m_fd) && tcgetattr(m_fd, &state.termOriginal) == 0)
+		{
+			termios raw = state.termOriginal;
+			raw.c_lflag &= ~(ECHO | ICANON);
+			tcsetattr(m_fd, TCSANOW, &raw);
+			state.bSaved = true;
+		}
+
+		state.fdRestore = m_fd;
+		state.bResized = 0;
+		signal(SIGINT, SignalHandler);
+		signal(SIGTERM, SignalHandler);
+		signal(SIGWINCH, ResizeHandler);
+
+		// Alternate screen, hidden cursor, cleared
+		WriteAll("\x1b[?1049h\x1b[?25l\x1b[0m\x1b[2J", 22);
+		m_bActive = true;
+
+		// Mouse buttons and movement in SGR form, and focus changes, but only when
+		// there is a terminal on stdin to report them
+		if (isatty(STDIN_FILENO))
+		{
+			WriteAll("\x1b[?1000h\x1b[?1003h\x1b[?1006h\x1b[?1004h", 32);
+			m_bReading = true;
+			m_threadInput = std::thread(&olcAnsiTerminalBackend::InputThread, this);
+		}
+		return true;
+	}
+
+	void PollInput(short* keyStates, bool* mouseStates, int& mouseX, int& mouseY, bool& bFocused) override
+	{
+		m_input.Drain(keyStates, mouseStates, mouseX, mouseY, bFocused);
+	}
+
+	void Present(const CHAR_INFO* buf, int width, int height) override
+	{
+		m_sFrame.clear();
+
+		// A resize may have reflowed or scrolled what is on screen, so start over
+		if (TerminalState().bResized)
+		{
+			TerminalState().bResized = 0;
+			Invalidate();
+			m_sFrame += "\x1b[0m\x1b[2J";
+		}
+
+		if (!m_sPendingTitle.empty())
+		{
+			m_sFrame += m_sPendingTitle;
+			m_sPendingTitle.clear();
+		}
+
+		// Terminal state as far as this frame knows; -1 forces a re-send
+		int nCursorX = -1, nCursorY = -1;
+		int nFg = -1, nBg = -1;
+
+		for (int y = 0; y < height; y++)
+		{
+			const CHAR_INFO* row = buf + y * width;
+			CHAR_INFO* prev = m_vecPrevious.data() + y * width;
+
+			int x = 0;
+			while (x < width)
+			{
+				if (!m_bFullRedraw && SameCell(row[x], prev[x]))
+				{
+					x++;
+					continue;
+				}
+
+				// Grow the run over changed cells. Short gaps of unchanged cells are
+				// cheaper to re-send than to jump over with a cursor move
+				int nStart = x;
+				int nEnd = x + 1;
+				while (nEnd < width)
+				{
+					if (m_bFullRedraw || !SameCell(row[nEnd], prev[nEnd]))
+					{
+						nEnd++;
+						continue;
+					}
+
+					int g = nEnd;
+					while (g < width && g - nEnd < nMaxGap && SameCell(row[g], prev[g]))
+						g++;
+
+					if (g < width && g - nEnd < nMaxGap)
+						nEnd = g;
+					else
+						break;
+				}
+
+				if (nCursorY != y || nCursorX != nStart)
+					AppendCursor(nStart, y);
+
+				for (int i = nStart; i < nEnd; i++)
+				{
+					int fg = row[i].Attributes & 0x0F;
+					int bg = (row[i].Attributes >> 4) & 0x0F;
+					if (fg != nFg || bg != nBg)
+					{
+						AppendColour(fg != nFg ? fg : -1, bg != nBg ? bg : -1);
+						nFg = fg;
+						nBg = bg;
+					}
+
+					AppendGlyph(row[i].Char.UnicodeChar);
+					prev[i] = row[i];
+				}
+
+				nCursorX = nEnd;
+				nCursorY = y;
+				x = nEnd;
+			}
+		}
+
+		m_bFullRedraw = false;
+
+		m_nLastFrameBytes = m_sFrame.size();
+		m_nTotalBytes += m_nLastFrameBytes;
+		if (m_nLastFrameBytes > m_nPeakFrameBytes)
+			m_nPeakFrameBytes = m_nLastFrameBytes;
+		m_nFrames++;
+
+		if (!m_sFrame.empty())
+			WriteAll(m_sFrame.data(), m_sFrame.size());
+	}
+
+	void SetTitle(const std::wstring& sTitle) override
+	{
+		// The title carries the FPS and changes every frame, so limit it to a
+		// couple of updates per second to keep it out of the bandwidth figures
+		auto tpNow = std::chrono::steady_clock::now();
+		if (tpNow - m_tpLastTitle < std::chrono::milliseconds(500))
+			return;
+		m_tpLastTitle = tpNow;
+
+		m_sPendingTitle = "\x1b]0;";
+		for (wchar_t c : sTitle)
+			m_sPendingTitle += (c >= 0x20 && c < 0x7F) ? (char)c : '?';
+		m_sPendingTitle += '\x07';
+	}
+
+	void Shutdown(const olcFrameTimings& timings) override
+	{
+		RestoreTerminal();
+
+		if (m_nFrames == 0)
+			return;
+
+		printf("ANSI presenter: %llu frames, %.1f KB/frame average, %.1f KB peak, %.1f KB last\n",
+			(unsigned long long)m_nFrames, AverageBytesPerFrame() / 1024.0,
+			m_nPeakFrameBytes / 1024.0, m_nLastFrameBytes / 1024.0);
+		if (timings.nFrames > 0)
+			printf("  %.2f FPS, present %.4f ms/frame\n",
+				timings.nFrames / timings.dTotalTime, 1000.0 * timings.dPresentTime / timings.nFrames);
+		if (m_input.Pushed() > 0)
+			printf("  input: %llu events, %llu dropped\n",
+				(unsigned long long)m_input.Pushed(), (unsigned long long)m_input.Dropped());
+	}
+
+	// Force the next frame to be sent in full; done after the terminal is resized
+	void Invalidate() { m_bFullRedraw = true; }
+
+	size_t BytesLastFrame() { return m_nLastFrameBytes; }
+	size_t BytesPeakFrame() { return m_nPeakFrameBytes; }
+	double AverageBytesPerFrame() { return m_nFrames ? (double)m_nTotalBytes / (double)m_nFrames : 0.0; }
+
+protected:
+	// Longest run of unchanged cells bridged rather than skipped with a cursor move
+	static const int nMaxGap = 6;
+
+	// Terminals send no key releases, so a release is inferred once a held key has
+	// gone this long without a repeat. The first repeat comes after the keyboard's
+	// autorepeat delay, 660 ms by default under X11 and 500 ms on most others, then
+	// repeats arrive a few dozen times a second. Too short a wait releases a key
+	// that is still held; too long a wait makes a tapped key stick.
+	static const int nFirstRepeatMs = 800;
+	static const int nRepeatMs = 100;
+
+	struct heldKey
+	{
+		bool bDown = false;
+		bool bRepeating = false;
+		std::chrono::steady_clock::time_point tpLast;
+	};
+
+	static bool SameCell(const CHAR_INFO& a, const CHAR_INFO& b)
+	{
+		return a.Char.UnicodeChar == b.Char.UnicodeChar && a.Attributes == b.Attributes;
+	}
+
+	void AppendNumber(int n)
+	{
+		char buf[12];
+		int i = 0;
+		do { buf[i++] = (char)('0' + n % 10); n /= 10; } while (n > 0);
+		while (i > 0)
+			m_sFrame += buf[--i];
+	}
+
+	void AppendCursor(int x, int y)
+	{
+		m_sFrame += "\x1b[";
+		AppendNumber(y + 1);
+		m_sFrame += ';';
+		AppendNumber(x + 1);
+		m_sFrame += 'H';
+	}
+
+	// Either colour may be -1 meaning "unchanged"
+	void AppendColour(int fg, int bg)
+	{
+		m_sFrame += "\x1b[";
+		bool bFirst = true;
+		auto emit = [&](int c, bool bBackground)
+		{
+			if (!bFirst)
+				m_sFrame += ';';
+			bFirst = false;
+
+			if (m_bTrueColour)
+			{
+				m_sFrame += bBackground ? "48;2;" : "38;2;";
+				const unsigned char* rgb = Palette(c);
+				AppendNumber(rgb[0]);
+				m_sFrame += ';';
+				AppendNumber(rgb[1]);
+				m_sFrame += ';';
+				AppendNumber(rgb[2]);
+			}
+			else
+			{
+				// Console colours are BGR ordered, ANSI ones RGB
+				int ansi = ((c & 1) << 2) | (c & 2) | ((c & 4) >> 2);
+				int base = bBackground ? ((c & 8) ? 100 : 40) : ((c & 8) ? 90 : 30);
+				AppendNumber(base + ansi);
+			}
+		};
+
+		if (fg >= 0) emit(fg, false);
+		if (bg >= 0) emit(bg, true);
+		m_sFrame += 'm';
+	}
+
+	void AppendGlyph(WCHAR c)
+	{
+		if (c < 0x20)
+			m_sFrame += ' ';
+		else if (c < 0x80)
+			m_sFrame += (char)c;
+		else if (c < 0x800)
+		{
+			m_sFrame += (char)(0xC0 | (c >> 6));
+			m_sFrame += (char)(0x80 | (c & 0x3F));
+		}
+		else
+		{
+			m_sFrame += (char)(0xE0 | (c >> 12));
+			m_sFrame += (char)(0x80 | ((c >> 6) & 0x3F));
+			m_sFrame += (char)(0x80 | (c & 0x3F));
+		}
+	}
+
+	void WriteAll(const char* p, size_t n)
+	{
+		while (n > 0)
+		{
+			ssize_t r = write(m_fd, p, n);
+			if (r < 0)
+			{
+				if (errno == EINTR || errno == EAGAIN)
+					continue;
+				return;
+			}
+			p += r;
+			n -= (size_t)r;
+		}
+	}
+
+	void InputThread()
+	{
+		unsigned char buf[256];
+		size_t nPending = 0; // Start of an escape sequence the last read cut in half
+
+		while (m_bReading)
+		{
+			// Short timeout, both to notice StopInput and to time out held keys
+			pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+			int r = poll(&pfd, 1, 10);
+			auto tpNow = std::chrono::steady_clock::now();
+
+			if (r > 0 && (pfd.revents & POLLIN))
+			{
+				ssize_t n = read(STDIN_FILENO, buf + nPending, sizeof(buf) - nPending);
+				if (n <= 0)
+				{
+					if (n < 0 && (errno == EINTR || errno == EAGAIN))
+						continue;
+					break;
+				}
+				nPending += (size_t)n;
+
+				size_t nUsed = ParseInput(buf, nPending, tpNow, nPending == sizeof(buf));
+				memmove(buf, buf + nUsed, nPending - nUsed);
+				nPending -= nUsed;
+			}
+			else if (r > 0)
+				break; // Hung up
+			else if (r == 0 && nPending > 0)
+			{
+				// Nothing followed, so a lone ESC was the Escape key
+				ParseInput(buf, nPending, tpNow, true);
+				nPending = 0;
+			}
+
+			for (int k = 0; k < 256; k++)
+			{
+				heldKey& h = m_held[k];
+				if (h.bDown && tpNow - h.tpLast > std::chrono::milliseconds(h.bRepeating ? (int)nRepeatMs : (int)nFirstRepeatMs))
+					ReleaseKey(k);
+			}
+		}
+	}
+
+	// Returns how many bytes were used. Unless bFlush is set, an escape sequence
+	// that runs off the end is left for the next read to complete.
+	size_t ParseInput(const unsigned char* p, size_t n, std::chrono::steady_clock::time_point tp, bool bFlush)
+	{
+		size_t i = 0;
+		while (i < n)
+		{
+			if (p[i] != 0x1B)
+			{
+				ParseChar(p[i], tp);
+				i++;
+				continue;
+			}
+
+			size_t nLen = ParseEscape(p + i, n - i, tp);
+			if (nLen == 0)
+			{
+				if (!bFlush)
+					break;
+				PressKey(VK_ESCAPE, tp);
+				nLen = 1;
+			}
+			i += nLen;
+		}
+		return i;
+	}
+
+	void ParseChar(unsigned char c, std::chrono::steady_clock::time_point tp)
+	{
+		if (c >= 'a' && c <= 'z')
+			PressKey(c - 'a' + 'A', tp);
+		else if (c >= 'A' && c <= 'Z')
+		{
+			PressModifiers(1, tp);
+			PressKey(c, tp);
+		}
+		else if ((c >= '0' && c <= '9') || c == ' ')
+			PressKey(c, tp);
+		else if (c == '\r' || c == '\n')
+			PressKey(VK_RETURN, tp);
+		else if (c == '\t')
+			PressKey(VK_TAB, tp);
+		else if (c == 0x7F || c == 0x08)
+			PressKey(VK_BACK, tp);
+		else if (c >= 0x01 && c <= 0x1A)
+		{
+			PressModifiers(4, tp);
+			PressKey(c - 1 + 'A', tp);
+		}
+		// Punctuation depends on the keyboard layout and has no fixed key code
+	}
+
+	// Length of the sequence starting with ESC at p, 0 if it is not complete yet
+	size_t ParseEscape(const unsigned char* p, size_t n, std::chrono::steady_clock::time_point tp)
+	{
+		if (n < 2)
+			return 0;
+
+		if (p[1] == 'O')
+		{
+			// SS3, sent for the arrows in application mode and for F1-F4
+			if (n < 3)
+				return 0;
+			ParseFinal(p[2], 1, 0, tp);
+			return 3;
+		}
+
+		if (p[1] == 0x1B)
+		{
+			PressKey(VK_ESCAPE, tp);
+			return 1;
+		}
+
+		if (p[1] != '[')
+		{
+			// Alt held with a key
+			PressModifiers(2, tp);
+			ParseChar(p[1], tp);
+			return 2;
+		}
+
+		// CSI: parameter bytes 0x30-0x3F, intermediate bytes 0x20-0x2F, then one
+		// final byte 0x40-0x7E. The only private marker understood is the '<' of
+		// SGR mouse reports. Anything with another marker or with intermediate
+		// bytes is a reply to a query, such as ESC[?1;2c, and is skipped whole.
+		size_t j = 2;
+		bool bMouse = j < n && p[j] == '<';
+		if (bMouse)
+			j++;
+		int nParams[4] = { 0, 0, 0, 0 };
+		int nCount = 0;
+		bool bSubParam = false; // After ':', which only qualifies the parameter
+		bool bIgnore = false;
+		for (; j < n && p[j] >= 0x30 && p[j] <= 0x3F; j++)
+		{
+			if (p[j] <= '9')
+			{
+				if (nCount < 4 && !bSubParam && nParams[nCount] < 100000)
+					nParams[nCount] = nParams[nCount] * 10 + (p[j] - '0');
+			}
+			else if (p[j] == ';')
+			{
+				nCount++;
+				bSubParam = false;
+			}
+			else if (p[j] == ':')
+				bSubParam = true;
+			else
+				bIgnore = true;
+		}
+		for (; j < n && p[j] >= 0x20 && p[j] <= 0x2F; j++)
+			bIgnore = true;
+		if (j >= n)
+			return n >= 32 ? n : 0; // Nothing this long is valid, drop it
+		if (p[j] < 0x40 || p[j] > 0x7E)
+			return j; // Cut short by a byte that cannot end it, drop what came before
+		if (bIgnore)
+			return j + 1;
+		nCount++;
+
+		unsigned char cFinal = p[j];
+		if (bMouse && (cFinal == 'M' || cFinal == 'm') && nCount >= 3)
+			ParseMouse(nParams[0], nParams[1] - 1, nParams[2] - 1, cFinal == 'M');
+		else if (cFinal == 'I' || cFinal == 'O')
+			SetFocus(cFinal == 'I');
+		else
+			ParseFinal(cFinal, nParams[0], nCount > 1 ? nParams[1] : 0, tp);
+		return j + 1;
+	}
+
+	// nModifier is 1 plus shift 1, alt 2 and ctrl 4, as xterm sends it
+	void ParseFinal(unsigned char cFinal, int nParam, int nModifier, std::chrono::steady_clock::time_point tp)
+	{
+		int k = 0;
+		switch (cFinal)
+		{
+		case 'A': k = VK_UP; break;
+		case 'B': k = VK_DOWN; break;
+		case 'C': k = VK_RIGHT; break;
+		case 'D': k = VK_LEFT; break;
+		case 'H': k = VK_HOME; break;
+		case 'F': k = VK_END; break;
+		case 'P': case 'Q': case 'R': case 'S': k = VK_F1 + (cFinal - 'P'); break;
+		case '~':
+			switch (nParam)
+			{
+			case 1: case 7: k = VK_HOME; break;
+			case 4: case 8: k = VK_END; break;
+			case 2: k = VK_INSERT; break;
+			case 3: k = VK_DELETE; break;
+			case 5: k = VK_PRIOR; break;
+			case 6: k = VK_NEXT; break;
+			case 11: case 12: case 13: case 14: case 15: k = VK_F1 + (nParam - 11); break;
+			case 17: case 18: case 19: case 20: case 21: k = VK_F1 + 5 + (nParam - 17); break;
+			case 23: case 24: k = VK_F1 + 10 + (nParam - 23); break;
+			default: break;
+			}
+			break;
+		default:
+			break;
+		}
+
+		if (k == 0)
+			return;
+		if (nModifier > 1)
+			PressModifiers(nModifier - 1, tp);
+		PressKey(k, tp);
+	}
+
+	// SGR mouse report: button in bits 0-1, 32 while moving, 64 and up for the wheel
+	void ParseMouse(int nButton, int x, int y, bool bPress)
+	{
+		if (x != m_nMouseX || y != m_nMouseY)
+		{
+			m_nMouseX = x;
+			m_nMouseY = y;
+			inputEvent e;
+			e.nType = INPUT_MOUSE_MOVE;
+			e.x = (int16_t)x;
+			e.y = (int16_t)y;
+			m_input.Push(e);
+		}
+
+		if (nButton & (32 | 64))
+			return;
+
+		// Left, middle, right in the report; left, right, middle in the engine
+		static const uint8_t nIndex[3] = { 0, 2, 1 };
+		if ((nButton & 3) == 3)
+			return;
+		inputEvent e;
+		e.nType = INPUT_MOUSE_BUTTON;
+		e.nCode = nIndex[nButton & 3];
+		e.bDown = bPress;
+		m_input.Push(e);
+	}
+
+	void SetFocus(bool bFocused)
+	{
+		inputEvent e;
+		e.nType = INPUT_FOCUS;
+		e.bDown = bFocused;
+		m_input.Push(e);
+
+		if (!bFocused)
+			for (int k = 0; k < 256; k++)
+				if (m_held[k].bDown)
+					ReleaseKey(k);
+	}
+
+	void PressModifiers(int nBits, std::chrono::steady_clock::time_point tp)
+	{
+		if (nBits & 1)
+		{
+			PressKey(VK_SHIFT, tp);
+			PressKey(VK_LSHIFT, tp);
+		}
+		if (nBits & 2)
+		{
+			PressKey(VK_MENU, tp);
+			PressKey(VK_LMENU, tp);
+		}
+		if (nBits & 4)
+		{
+			PressKey(VK_CONTROL, tp);
+			PressKey(VK_LCONTROL, tp);
+		}
+	}
+
+	// A press of a key already held is one of its repeats
+	void PressKey(int k, std::chrono::steady_clock::time_point tp)
+	{
+		heldKey& h = m_held[k];
+		h.bRepeating = h.bDown;
+		h.tpLast = tp;
+		if (h.bDown)
+			return;
+		h.bDown = true;
+
+		inputEvent e;
+		e.nType = INPUT_KEY;
+		e.nCode = (uint8_t)k;
+		e.bDown = true;
+		m_input.Push(e);
+	}
+
+	void ReleaseKey(int k)
+	{
+		m_held[k].bDown = false;
+		m_held[k].bRepeating = false;
+
+		inputEvent e;
+		e.nType = INPUT_KEY;
+		e.nCode = (uint8_t)k;
+		e.bDown = false;
+		m_input.Push(e);
+	}
+
+	void StopInput()
+	{
+		m_bReading = false;
+		if (m_threadInput.joinable())
+			m_threadInput.join();
+	}
+
+	void RestoreTerminal()
+	{
+		StopInput();
+		if (!m_bActive)
+			return;
+		m_bActive = false;
+
+		signal(SIGWINCH, SIG_DFL);
+
+		size_t nLength;
+		const char* sRestore = RestoreSequence(nLength);
+		WriteAll(sRestore, nLength);
+
+		terminalState& state = TerminalState();
+		if (state.bSaved)
+		{
+			tcsetattr(m_fd, TCSANOW, &state.termOriginal);
+			state.bSaved = false;
+		}
+	}
+
+	// Ctrl+C would otherwise leave the terminal on the alternate screen with echo off
+	static void SignalHandler(int sig)
+	{
+		terminalState& state = TerminalState();
+		size_t nLength;
+		const char* sRestore = RestoreSequence(nLength);
+		ssize_t r = write(state.fdRestore, sRestore, nLength);
+		(void)r;
+		if (state.bSaved)
+			tcsetattr(state.fdRestore, TCSANOW, &state.termOriginal);
+		_exit(128 + sig);
+	}
+
+	static void ResizeHandler(int /*sig*/)
+	{
+		TerminalState().bResized = 1;
+	}
+
+	// What the signal handlers need. Kept in function-local statics rather than
+	// static members so the header can be included from more than one file.
+	struct terminalState
+	{
+		termios termOriginal;
+		bool bSaved;
+		int fdRestore;
+		volatile sig_atomic_t bResized;
+	};
+
+	static terminalState& TerminalState()
+	{
+		static terminalState state = { termios(), false, STDOUT_FILENO, 0 };
+		return state;
+	}
+
+	// Mouse and focus reports off, colours reset, cursor back, main screen
+	static const char* RestoreSequence(size_t& nLength)
+	{
+		static const char sRestore[] = "\x1b[?1004l\x1b[?1006l\x1b[?1003l\x1b[?1000l\x1b[0m\x1b[?25h\x1b[?1049l";
+		nLength = sizeof(sRestore) - 1;
+		return sRestore;
+	}
+
+	// Legacy Windows console palette, indexed by the 4 bit attribute
+	static const unsigned char* Palette(int c)
+	{
+		static const unsigned char palette[16][3] =
+		{
+			{   0,   0,   0 }, {   0,   0, 128 }, {   0, 128,   0 }, {   0, 128, 128 },
+			{ 128,   0,   0 }, { 128,   0, 128 }, { 128, 128,   0 }, { 192, 192, 192 },
+			{ 128, 128, 128 }, {   0,   0, 255 }, {   0, 255,   0 }, {   0, 255, 255 },
+			{ 255,   0,   0 }, { 255,   0, 255 }, { 255, 255,   0 }, { 255, 255, 255 },
+		};
+		return palette[c];
+	}
+
+	int m_fd;
+	bool m_bTrueColour;
+	bool m_bActive = false;
+	bool m_bFullRedraw = true;
+	int m_nWidth = 0;
+	int m_nHeight = 0;
+	std::vector<CHAR_INFO> m_vecPrevious;
+	std::string m_sFrame;
+	std::string m_sPendingTitle;
+	std::chrono::steady_clock::time_point m_tpLastTitle;
+
+	size_t m_nLastFrameBytes = 0;
+	size_t m_nPeakFrameBytes = 0;
+	uint64_t m_nTotalBytes = 0;
+	uint64_t m_nFrames = 0;
+
+	inputQueue m_input;
+	std::thread m_threadInput;
+	std::atomic<bool> m_bReading{ false };
+
+	// Reader thread only
+	heldKey m_held[256];
+	int m_nMouseX = -1;
+	int m_nMouseY = -1;
+};
+
+#endif
+
+#endif
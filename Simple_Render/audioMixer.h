@@ -0,0 +1,255 @@
+#pragma once
+
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+// Mixes loaded samples a whole block at a time for the audio thread. The game
+// thread never touches the playing voices: PlaySample and StopSample become
+// commands in a fixed ring that the audio thread applies at the start of each
+// block. Voices live in a fixed array, so once the samples are loaded nothing
+// on the audio thread locks or allocates.
+//
+// Samples play one frame per output frame, so they must be at the output's
+// sample rate, which the loader already insists on.
+
+enum AUDIO_COMMAND
+{
+	AUDIO_PLAY,
+	AUDIO_STOP,     // Every voice playing the sample
+	AUDIO_STOP_ALL,
+};
+
+struct audioCommand
+{
+	uint8_t nType = AUDIO_PLAY;
+	bool bLoop = false;
+	int nSampleID = 0;
+	float fVolume = 1.0f;
+};
+
+class audioMixer
+{
+public:
+	static const size_t nMaxVoices = 256;
+	static const size_t nMaxSamples = 1024;
+	static const size_t nCommandCapacity = 256; // Power of two
+
+	// Game thread. The data is interleaved, nFrames * nChannels floats, and must
+	// stay valid while the mixer is in use. Returns the sample's ID, counting from
+	// 1, or 0 if the table is full.
+	int AddSample(const float* pData, long nFrames, int nChannels)
+	{
+		size_t n = m_nSamples.load(std::memory_order_relaxed);
+		if (n >= nMaxSamples || pData == nullptr || nFrames <= 0 || nChannels <= 0)
+			return 0;
+
+		m_samples[n].pData = pData;
+		m_samples[n].nFrames = nFrames;
+		m_samples[n].nChannels = nChannels;
+		m_nSamples.store(n + 1, std::memory_order_release);
+		return (int)n + 1;
+	}
+
+	// Game thread. False if the audio thread is too far behind to take the command
+	bool Play(int nSampleID, bool bLoop = false, float fVolume = 1.0f)
+	{
+		audioCommand c;
+		c.nType = AUDIO_PLAY;
+		c.nSampleID = nSampleID;
+		c.bLoop = bLoop;
+		c.fVolume = fVolume;
+		return Push(c);
+	}
+
+	bool Stop(int nSampleID)
+	{
+		audioCommand c;
+		c.nType = AUDIO_STOP;
+		c.nSampleID = nSampleID;
+		return Push(c);
+	}
+
+	bool StopAll()
+	{
+		audioCommand c;
+		c.nType = AUDIO_STOP_ALL;
+		return Push(c);
+	}
+
+	// Audio thread. Writes nFrames frames of nChannels interleaved channels, the
+	// sum of every playing voice. Sample channels beyond the output's are left
+	// out and a mono sample is spread over all of them.
+	void Mix(float* pOut, unsigned int nFrames, unsigned int nChannels)
+	{
+		ApplyCommands();
+		std::fill(pOut, pOut + nFrames * nChannels, 0.0f);
+
+		size_t v = 0;
+		while (v < m_nVoices)
+		{
+			if (MixVoice(m_voices[v], pOut, nFrames, nChannels))
+				v++;
+			else
+				m_voices[v] = m_voices[--m_nVoices]; // Finished, order does not matter
+		}
+		m_nPlaying.store(m_nVoices, std::memory_order_relaxed);
+	}
+
+	// Voices playing as of the last block
+	size_t Playing() const
+	{
+		return m_nPlaying.load(std::memory_order_relaxed);
+	}
+
+	// Commands lost because the ring was full, and plays ignored because every
+	// voice was in use
+	uint64_t DroppedCommands() const
+	{
+		return m_nDroppedCommands.load(std::memory_order_relaxed);
+	}
+
+	uint64_t DroppedVoices() const
+	{
+		return m_nDroppedVoices.load(std::memory_order_relaxed);
+	}
+
+private:
+	struct sample
+	{
+		const float* pData = nullptr;
+		long nFrames = 0;
+		int nChannels = 0;
+	};
+
+	struct voice
+	{
+		const sample* pSample = nullptr;
+		int nSampleID = 0;
+		long nPosition = 0; // Next frame to play
+		float fVolume = 1.0f;
+		bool bLoop = false;
+	};
+
+	bool Push(const audioCommand& c)
+	{
+		size_t nTail = m_nTail.load(std::memory_order_relaxed);
+		if (nTail - m_nHead.load(std::memory_order_acquire) >= nCommandCapacity)
+		{
+			m_nDroppedCommands.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		m_commands[nTail & (nCommandCapacity - 1)] = c;
+		m_nTail.store(nTail + 1, std::memory_order_release);
+		return true;
+	}
+
+	void ApplyCommands()
+	{
+		size_t nHead = m_nHead.load(std::memory_order_relaxed);
+		size_t nTail = m_nTail.load(std::memory_order_acquire);
+		size_t nSamples = m_nSamples.load(std::memory_order_acquire);
+
+		for (; nHead != nTail; nHead++)
+		{
+			const audioCommand& c = m_commands[nHead & (nCommandCapacity - 1)];
+			switch (c.nType)
+			{
+			case AUDIO_PLAY:
+				if (c.nSampleID < 1 || (size_t)c.nSampleID > nSamples)
+					break;
+				if (m_nVoices == nMaxVoices)
+				{
+					m_nDroppedVoices.fetch_add(1, std::memory_order_relaxed);
+					break;
+				}
+				m_voices[m_nVoices].pSample = &m_samples[c.nSampleID - 1];
+				m_voices[m_nVoices].nSampleID = c.nSampleID;
+				m_voices[m_nVoices].nPosition = 0;
+				m_voices[m_nVoices].fVolume = c.fVolume;
+				m_voices[m_nVoices].bLoop = c.bLoop;
+				m_nVoices++;
+				break;
+
+			case AUDIO_STOP:
+				for (size_t v = 0; v < m_nVoices;)
+				{
+					if (m_voices[v].nSampleID == c.nSampleID)
+						m_voices[v] = m_voices[--m_nVoices];
+					else
+						v++;
+				}
+				break;
+
+			case AUDIO_STOP_ALL:
+				m_nVoices = 0;
+				break;
+
+			default:
+				break;
+			}
+		}
+		m_nHead.store(nHead, std::memory_order_release);
+	}
+
+	// Adds the voice into the block in runs that stop at the end of the sample,
+	// false once it has finished
+	static bool MixVoice(voice& v, float* pOut, unsigned int nFrames, unsigned int nChannels)
+	{
+		const sample& s = *v.pSample;
+		unsigned int f = 0;
+		while (f < nFrames)
+		{
+			if (v.nPosition >= s.nFrames)
+			{
+				if (!v.bLoop)
+					return false;
+				v.nPosition = 0;
+			}
+
+			unsigned int nRun = (unsigned int)std::min<long>((long)(nFrames - f), s.nFrames - v.nPosition);
+			const float* pIn = s.pData + (size_t)v.nPosition * s.nChannels;
+			float* pDst = pOut + (size_t)f * nChannels;
+
+			if ((unsigned int)s.nChannels == nChannels)
+			{
+				for (unsigned int i = 0; i < nRun * nChannels; i++)
+					pDst[i] += pIn[i] * v.fVolume;
+			}
+			else
+			{
+				for (unsigned int i = 0; i < nRun; i++)
+					for (unsigned int c = 0; c < nChannels; c++)
+						pDst[i * nChannels + c] += pIn[i * s.nChannels + c % s.nChannels] * v.fVolume;
+			}
+
+			v.nPosition += nRun;
+			f += nRun;
+		}
+		return v.nPosition < s.nFrames || v.bLoop;
+	}
+
+	sample m_samples[nMaxSamples];
+	std::atomic<size_t> m_nSamples{ 0 };
+
+	audioCommand m_commands[nCommandCapacity];
+	char m_pad0[64];
+	std::atomic<size_t> m_nHead{ 0 };
+	char m_pad1[64];
+	std::atomic<size_t> m_nTail{ 0 };
+	char m_pad2[64];
+
+	// Audio thread only
+	voice m_voices[nMaxVoices];
+	size_t m_nVoices = 0;
+
+	std::atomic<size_t> m_nPlaying{ 0 };
+	std::atomic<uint64_t> m_nDroppedCommands{ 0 };
+	std::atomic<uint64_t> m_nDroppedVoices{ 0 };
+};
+
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include "utils.h"
+
+#include <vector>
+#include <algorithm>
+
+// A camera position and orientation, yaw and pitch as gameEngine3D uses them
+struct cameraKey
+{
+	vec3d vPosition = { 0.0f, 0.0f, 0.0f };
+	float fYaw = 0.0f;
+	float fPitch = 0.0f;
+};
+
+// Keys spread evenly over t = 0 to 1, with the camera moving in straight lines
+// between them. Used to fly the camera the same way on every run.
+class cameraPath
+{
+public:
+	void Add(const vec3d& vPosition, float fYaw, float fPitch)
+	{
+		cameraKey key;
+		key.vPosition = vPosition;
+		key.fYaw = fYaw;
+		key.fPitch = fPitch;
+		m_vecKeys.push_back(key);
+	}
+
+	bool Empty() const
+	{
+		return m_vecKeys.empty();
+	}
+
+	cameraKey At(float t) const
+	{
+		if (m_vecKeys.size() < 2)
+			return m_vecKeys.empty() ? cameraKey() : m_vecKeys[0];
+
+		float fKey = std::min(std::max(t, 0.0f), 1.0f) * (m_vecKeys.size() - 1);
+		size_t k = std::min((size_t)fKey, m_vecKeys.size() - 2);
+		float f = fKey - k;
+		const cameraKey& a = m_vecKeys[k];
+		const cameraKey& b = m_vecKeys[k + 1];
+
+		cameraKey key;
+		key.vPosition.x = a.vPosition.x + (b.vPosition.x - a.vPosition.x) * f;
+		key.vPosition.y = a.vPosition.y + (b.vPosition.y - a.vPosition.y) * f;
+		key.vPosition.z = a.vPosition.z + (b.vPosition.z - a.vPosition.z) * f;
+		key.fYaw = a.fYaw + (b.fYaw - a.fYaw) * f;
+		key.fPitch = a.fPitch + (b.fPitch - a.fPitch) * f;
+		return key;
+	}
+
+private:
+	std::vector<cameraKey> m_vecKeys;
+};
+
+#endif
@@ -0,0 +1,499 @@
+#pragma once
+
+#ifndef CLUSTER_BVH_H
+#define CLUSTER_BVH_H
+
+#include "utils.h"
+#include "meshSimplifier.h"
+#include "workerPool.h"
+
+#include <algorithm>
+#include <cfloat>
+
+// Axis aligned bounding box
+struct aabb
+{
+	float fMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float fMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	void Add(float x, float y, float z)
+	{
+		fMin[0] = std::min(fMin[0], x); fMax[0] = std::max(fMax[0], x);
+		fMin[1] = std::min(fMin[1], y); fMax[1] = std::max(fMax[1], y);
+		fMin[2] = std::min(fMin[2], z); fMax[2] = std::max(fMax[2], z);
+	}
+
+	void Add(const aabb& b)
+	{
+		for (int a = 0; a < 3; a++)
+		{
+			fMin[a] = std::min(fMin[a], b.fMin[a]);
+			fMax[a] = std::max(fMax[a], b.fMax[a]);
+		}
+	}
+
+	int LongestAxis() const
+	{
+		float dx = fMax[0] - fMin[0], dy = fMax[1] - fMin[1], dz = fMax[2] - fMin[2];
+		return dx >= dy && dx >= dz ? 0 : (dy >= dz ? 1 : 2);
+	}
+};
+
+enum FRUSTUM_TEST
+{
+	FRUSTUM_OUTSIDE,
+	FRUSTUM_INTERSECTS,
+	FRUSTUM_INSIDE,
+};
+
+// The side planes of a view volume, pointing inwards, in whatever space the
+// matrix they were taken from starts in. There is no far plane because the
+// pipeline never clips against one.
+struct frustum
+{
+	float fPlanes[5][4];
+
+	// m takes points to clip space as a row vector matrix, e.g. matWorldView * matProj
+	// gives planes in model space. fMarginX and fMarginY widen the sides, in
+	// normalised device units, so cells the rasterizer rounds onto the screen edge
+	// are never culled.
+	void FromMatrix(const mat4x4& m, float fMarginX = 0.0f, float fMarginY = 0.0f)
+	{
+		for (int r = 0; r < 4; r++)
+		{
+			float x = m.m[r][0], y = m.m[r][1], z = m.m[r][2], w = m.m[r][3];
+			fPlanes[0][r] = w * (1.0f + fMarginX) + x; // left,   x >= -w
+			fPlanes[1][r] = w * (1.0f + fMarginX) - x; // right,  x <= w
+			fPlanes[2][r] = w * (1.0f + fMarginY) + y; // bottom, y >= -w
+			fPlanes[3][r] = w * (1.0f + fMarginY) - y; // top,    y <= w
+			fPlanes[4][r] = z + w * 0.001f;            // near,   z >= 0 (a hair behind)
+		}
+	}
+
+	FRUSTUM_TEST Test(const aabb& b) const
+	{
+		FRUSTUM_TEST result = FRUSTUM_INSIDE;
+		for (auto& p : fPlanes)
+		{
+			// Corner furthest along the plane normal, and the one furthest against it
+			float fNear = p[3], fFar = p[3];
+			for (int a = 0; a < 3; a++)
+			{
+				fNear += p[a] * (p[a] >= 0.0f ? b.fMax[a] : b.fMin[a]);
+				fFar += p[a] * (p[a] >= 0.0f ? b.fMin[a] : b.fMax[a]);
+			}
+			if (fNear < 0.0f)
+				return FRUSTUM_OUTSIDE;
+			if (fFar < 0.0f)
+				result = FRUSTUM_INTERSECTS;
+		}
+		return result;
+	}
+};
+
+// One level of detail of a cluster: a run of triangles, and how far (in model
+// units) its surface may stray from the full detail one
+struct clusterLod
+{
+	uint32_t nFirstTriangle;
+	uint32_t nTriangleCount;
+	float fError;
+};
+
+const int nMaxClusterLods = 4;
+
+// A run of triangles close together in space, and the vertices they use
+struct meshCluster
+{
+	aabb bounds;
+	uint32_t nFirstTriangle;
+	uint32_t nTriangleCount;
+
+	// lods[0] is the full detail run above, each further level has about half the
+	// triangles of the one before. Only the one level exists until BuildLods.
+	clusterLod lods[nMaxClusterLods];
+	int nLodCount;
+	uint32_t nFirstVertex; // Every vertex the cluster uses lies in [nFirstVertex, nFirstVertex + nVertexCount)
+	uint32_t nVertexCount;
+
+	// Bounding sphere, and a cone holding every face normal: all of them are
+	// within acos(sqrt(1 - fConeCutoff^2)) of vConeAxis. A cutoff of 1 or more
+	// means the normals are too spread out for the cone to be any use.
+	vec3d vCentre;
+	float fRadius;
+	vec3d vConeAxis;
+	float fConeCutoff;
+
+	// True if no triangle of the cluster can face a camera at vCamera (same space as the mesh)
+	bool IsBackfacing(const vec3d& vCamera) const
+	{
+		float dx = vCentre.x - vCamera.x, dy = vCentre.y - vCamera.y, dz = vCentre.z - vCamera.z;
+		float fDistance = sqrtf(dx * dx + dy * dy + dz * dz);
+		// Every point of the sphere must see every normal of the cone from behind
+		return dx * vConeAxis.x + dy * vConeAxis.y + dz * vConeAxis.z >= fConeCutoff * (fDistance + fRadius) + fRadius;
+	}
+};
+
+// Splits an indexedMesh into clusters of nearby triangles under a bounding
+// volume hierarchy, so whole clusters can be dropped before any per-triangle or
+// per-vertex work. Building reorders the mesh: each cluster's triangles become
+// one contiguous run of indices, and vertices are renumbered in order of first
+// use so a cluster's vertices sit close together too. Face normals, if the mesh
+// has them, follow their triangles and give every cluster a normal cone.
+class clusterBVH
+{
+public:
+	void Build(indexedMesh& m, uint32_t nMaxClusterTriangles = 128)
+	{
+		m_vecNodes.clear();
+		m_vecClusters.clear();
+
+		uint32_t nTriangles = (uint32_t)m.TriangleCount();
+		if (nTriangles == 0)
+			return;
+
+		std::vector<uint32_t> vecOrder(nTriangles);
+		std::vector<float> vecCentroids(nTriangles * 3);
+		for (uint32_t t = 0; t < nTriangles; t++)
+		{
+			vecOrder[t] = t;
+			for (int a = 0; a < 3; a++)
+			{
+				const std::vector<float>& axis = a == 0 ? m.verts.x : (a == 1 ? m.verts.y : m.verts.z);
+				vecCentroids[t * 3 + a] = axis[m.indices[t * 3]] + axis[m.indices[t * 3 + 1]] + axis[m.indices[t * 3 + 2]];
+			}
+		}
+
+		m_vecNodes.emplace_back();
+		BuildNode(0, m, vecOrder, vecCentroids, 0, nTriangles, std::max(nMaxClusterTriangles, 1u));
+
+		// Triangles in cluster order, then vertices in order of first use. Vertices
+		// no triangle refers to go last.
+		std::vector<uint32_t> vecIndices(m.indices.size());
+		for (uint32_t t = 0; t < nTriangles; t++)
+			for (int k = 0; k < 3; k++)
+				vecIndices[t * 3 + k] = m.indices[vecOrder[t] * 3 + k];
+
+		const uint32_t nUnused = 0xFFFFFFFF;
+		std::vector<uint32_t> vecRemap(m.verts.size(), nUnused);
+		uint32_t nNext = 0;
+		for (uint32_t& i : vecIndices)
+		{
+			if (vecRemap[i] == nUnused)
+				vecRemap[i] = nNext++;
+			i = vecRemap[i];
+		}
+		for (uint32_t& r : vecRemap)
+			if (r == nUnused)
+				r = nNext++;
+
+		vertexArrays verts;
+		verts.resize(m.verts.size());
+		for (size_t v = 0; v < vecRemap.size(); v++)
+		{
+			verts.x[vecRemap[v]] = m.verts.x[v];
+			verts.y[vecRemap[v]] = m.verts.y[v];
+			verts.z[vecRemap[v]] = m.verts.z[v];
+		}
+		m.verts = std::move(verts);
+		m.indices = std::move(vecIndices);
+
+		bool bNormals = m.normals.size() == nTriangles;
+		if (bNormals)
+		{
+			vertexArrays normals;
+			normals.resize(nTriangles);
+			for (uint32_t t = 0; t < nTriangles; t++)
+			{
+				normals.x[t] = m.normals.x[vecOrder[t]];
+				normals.y[t] = m.normals.y[vecOrder[t]];
+				normals.z[t] = m.normals.z[vecOrder[t]];
+			}
+			m.normals = std::move(normals);
+		}
+
+		for (auto& c : m_vecClusters)
+		{
+			uint32_t nMin = 0xFFFFFFFF, nMax = 0;
+			for (uint32_t i = c.nFirstTriangle * 3; i < (c.nFirstTriangle + c.nTriangleCount) * 3; i++)
+			{
+				nMin = std::min(nMin, m.indices[i]);
+				nMax = std::max(nMax, m.indices[i]);
+			}
+			c.nFirstVertex = nMin;
+			c.nVertexCount = nMax - nMin + 1;
+
+			c.vCentre = { (c.bounds.fMin[0] + c.bounds.fMax[0]) * 0.5f, (c.bounds.fMin[1] + c.bounds.fMax[1]) * 0.5f,
+				(c.bounds.fMin[2] + c.bounds.fMax[2]) * 0.5f, 1.0f };
+			c.fRadius = 0.0f;
+			for (uint32_t v = nMin; v <= nMax; v++)
+			{
+				float dx = m.verts.x[v] - c.vCentre.x, dy = m.verts.y[v] - c.vCentre.y, dz = m.verts.z[v] - c.vCentre.z;
+				c.fRadius = std::max(c.fRadius, dx * dx + dy * dy + dz * dz);
+			}
+			c.fRadius = sqrtf(c.fRadius) * 1.0001f;
+
+			c.lods[0] = { c.nFirstTriangle, c.nTriangleCount, 0.0f };
+			c.nLodCount = 1;
+			BuildNormalCone(c, m, bNormals);
+		}
+	}
+
+	// Simplifies every cluster into up to nMaxClusterLods - 1 coarser levels,
+	// appending their triangles (and face normals) to the end of the mesh. Vertices
+	// on a cluster's border are locked so neighbouring clusters at different
+	// levels still meet without cracks. Call after Build and ComputeFaceNormals;
+	// the mesh then holds more triangles than the file did, the extra ones only
+	// reachable through the clusters. With a pool the clusters are simplified on
+	// all of its threads; the result is the same either way.
+	void BuildLods(indexedMesh& m, workerPool* pPool = nullptr)
+	{
+		bool bNormals = m.normals.size() == m.TriangleCount();
+
+		// A vertex used by two clusters is on both their borders
+		const uint32_t nNone = 0xFFFFFFFF, nShared = 0xFFFFFFFE;
+		std::vector<uint32_t> vecOwner(m.verts.size(), nNone);
+		for (uint32_t c = 0; c < (uint32_t)m_vecClusters.size(); c++)
+			for (uint32_t i = m_vecClusters[c].nFirstTriangle * 3; i < (m_vecClusters[c].nFirstTriangle + m_vecClusters[c].nTriangleCount) * 3; i++)
+			{
+				uint32_t& nOwner = vecOwner[m.indices[i]];
+				nOwner = nOwner == nNone || nOwner == c ? c : nShared;
+			}
+
+		// Bytes rather than bits, as clusters set their own vertices concurrently
+		std::vector<uint8_t> bLocked(m.verts.size());
+		for (size_t v = 0; v < bLocked.size(); v++)
+			bLocked[v] = vecOwner[v] == nShared;
+
+		// Every cluster's coarser levels, one after another, until they are
+		// appended to the mesh in cluster order
+		std::vector<std::vector<uint32_t>> vecClusterLevels(m_vecClusters.size());
+
+		auto simplify = [&](size_t nCluster)
+		{
+			meshCluster& c = m_vecClusters[nCluster];
+			std::vector<uint32_t> vecLevel(m.indices.begin() + c.nFirstTriangle * 3, m.indices.begin() + (c.nFirstTriangle + c.nTriangleCount) * 3);
+			std::vector<uint32_t> vecSimplified;
+
+			// Open edges, used by a single triangle, are the cluster's outline. Only
+			// vertices no other cluster uses are written, the shared ones are
+			// locked already.
+			std::vector<uint64_t> vecEdges(vecLevel.size());
+			for (size_t i = 0; i < vecLevel.size(); i++)
+			{
+				uint32_t a = vecLevel[i], b = vecLevel[i - i % 3 + (i + 1) % 3];
+				vecEdges[i] = ((uint64_t)std::min(a, b) << 32) | std::max(a, b);
+			}
+			std::sort(vecEdges.begin(), vecEdges.end());
+			for (size_t i = 0; i < vecEdges.size(); i++)
+			{
+				bool bOpen = (i == 0 || vecEdges[i - 1] != vecEdges[i]) && (i + 1 == vecEdges.size() || vecEdges[i + 1] != vecEdges[i]);
+				if (!bOpen)
+					continue;
+				uint32_t a = (uint32_t)(vecEdges[i] >> 32), b = (uint32_t)vecEdges[i];
+				if (vecOwner[a] != nShared)
+					bLocked[a] = true;
+				if (vecOwner[b] != nShared)
+					bLocked[b] = true;
+			}
+
+			c.nLodCount = 1;
+			float fError = 0.0f;
+			while (c.nLodCount < nMaxClusterLods)
+			{
+				size_t nTarget = vecLevel.size() / 3 / 2;
+				float fLevelError = SimplifyTriangles(m.verts, vecLevel, bLocked, nTarget, vecSimplified);
+
+				// Not worth a level if the locked outline stopped it from shrinking much
+				if (vecSimplified.size() * 4 > vecLevel.size() * 3)
+					break;
+
+				// nFirstTriangle is relative to this cluster's levels for now
+				fError += fLevelError;
+				c.lods[c.nLodCount++] = { (uint32_t)(vecClusterLevels[nCluster].size() / 3), (uint32_t)(vecSimplified.size() / 3), fError };
+				vecClusterLevels[nCluster].insert(vecClusterLevels[nCluster].end(), vecSimplified.begin(), vecSimplified.end());
+				vecLevel.swap(vecSimplified);
+			}
+		};
+
+		if (pPool)
+			pPool->ParallelFor(m_vecClusters.size(), simplify);
+		else
+			for (size_t c = 0; c < m_vecClusters.size(); c++)
+				simplify(c);
+
+		size_t nExtra = 0;
+		for (auto& v : vecClusterLevels)
+			nExtra += v.size();
+		m.indices.reserve(m.indices.size() + nExtra);
+		for (size_t nCluster = 0; nCluster < m_vecClusters.size(); nCluster++)
+		{
+			meshCluster& c = m_vecClusters[nCluster];
+			uint32_t nBase = (uint32_t)m.TriangleCount();
+			for (int l = 1; l < c.nLodCount; l++)
+				c.lods[l].nFirstTriangle += nBase;
+			m.indices.insert(m.indices.end(), vecClusterLevels[nCluster].begin(), vecClusterLevels[nCluster].end());
+		}
+
+		if (bNormals)
+		{
+			m.ComputeFaceNormals();
+			for (auto& c : m_vecClusters)
+				BuildNormalCone(c, m, true);
+		}
+	}
+
+	// Coarsest level whose error, seen from vCamera, stays under fMaxCells cells.
+	// fCellsPerUnit is the size in cells of one model unit at a distance of one.
+	const clusterLod& SelectLod(uint32_t nCluster, const vec3d& vCamera, float fCellsPerUnit, float fMaxCells) const
+	{
+		const meshCluster& c = m_vecClusters[nCluster];
+		float dx = c.vCentre.x - vCamera.x, dy = c.vCentre.y - vCamera.y, dz = c.vCentre.z - vCamera.z;
+		float fDistance = std::max(sqrtf(dx * dx + dy * dy + dz * dz) - c.fRadius, 0.1f);
+
+		int nLod = 0;
+		while (nLod + 1 < c.nLodCount && c.lods[nLod + 1].fError * fCellsPerUnit / fDistance <= fMaxCells)
+			nLod++;
+		return c.lods[nLod];
+	}
+
+	// Appends the index of every cluster that may be visible to vecVisible, in
+	// cluster order. Clusters that only show their backs to vCamera are left out.
+	void Cull(const frustum& f, const vec3d& vCamera, std::vector<uint32_t>& vecVisible) const
+	{
+		if (m_vecNodes.empty())
+			return;
+
+		uint32_t nStack[64];
+		int nDepth = 0;
+		nStack[nDepth++] = 0;
+		while (nDepth > 0)
+		{
+			const bvhNode& node = m_vecNodes[nStack[--nDepth]];
+			FRUSTUM_TEST test = f.Test(node.bounds);
+			if (test == FRUSTUM_OUTSIDE)
+				continue;
+
+			// Wholly inside, or a single cluster: no need to look any closer
+			if (test == FRUSTUM_INSIDE || node.nChild == 0)
+			{
+				for (uint32_t c = node.nFirstCluster; c < node.nFirstCluster + node.nClusterCount; c++)
+					if (!m_vecClusters[c].IsBackfacing(vCamera))
+						vecVisible.push_back(c);
+				continue;
+			}
+
+			// Right first so the left child, holding the earlier clusters, is popped first
+			nStack[nDepth++] = node.nChild + 1;
+			nStack[nDepth++] = node.nChild;
+		}
+	}
+
+	const std::vector<meshCluster>& Clusters() const { return m_vecClusters; }
+
+private:
+	struct bvhNode
+	{
+		aabb bounds;
+		uint32_t nFirstCluster = 0;
+		uint32_t nClusterCount = 0;
+		uint32_t nChild = 0; // Children are nChild and nChild + 1, 0 for a leaf
+	};
+
+	// Averages the face normals for the axis, then widens the cone to the normal
+	// furthest from it. Zero normals belong to degenerate triangles and are ignored.
+	static void BuildNormalCone(meshCluster& c, const indexedMesh& m, bool bNormals)
+	{
+		c.vConeAxis = { 0.0f, 0.0f, 0.0f, 0.0f };
+		c.fConeCutoff = 1.0f;
+		if (!bNormals)
+			return;
+
+		// Every level has to fit, whichever one gets drawn
+		vec3d vSum = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int l = 0; l < c.nLodCount; l++)
+			for (uint32_t t = c.lods[l].nFirstTriangle; t < c.lods[l].nFirstTriangle + c.lods[l].nTriangleCount; t++)
+				vSum += m.normals.Get(t);
+		float fLength = sqrtf(vSum.x * vSum.x + vSum.y * vSum.y + vSum.z * vSum.z);
+		if (fLength <= 0.0f)
+			return;
+		vSum *= 1.0f / fLength;
+
+		float fMinDot = 1.0f;
+		for (int l = 0; l < c.nLodCount; l++)
+			for (uint32_t t = c.lods[l].nFirstTriangle; t < c.lods[l].nFirstTriangle + c.lods[l].nTriangleCount; t++)
+			{
+				vec3d n = m.normals.Get(t);
+				if (n.x != 0.0f || n.y != 0.0f || n.z != 0.0f)
+					fMinDot = std::min(fMinDot, n.x * vSum.x + n.y * vSum.y + n.z * vSum.z);
+			}
+
+		// Wider than a hemisphere, the cluster faces every direction somewhere
+		if (fMinDot <= 0.0f)
+			return;
+
+		c.vConeAxis = vSum;
+		// sin of the cone angle, nudged up against rounding so the test stays conservative
+		c.fConeCutoff = std::min(sqrtf(1.0f - fMinDot * fMinDot) + 1e-3f, 1.0f);
+	}
+
+	// Median split of triangles [nBegin, nEnd) of vecOrder along the longest axis
+	// of their centroids, until a run is small enough to be a cluster
+	void BuildNode(uint32_t nNode, const indexedMesh& m, std::vector<uint32_t>& vecOrder, const std::vector<float>& vecCentroids,
+		uint32_t nBegin, uint32_t nEnd, uint32_t nMaxClusterTriangles)
+	{
+		m_vecNodes[nNode].nFirstCluster = (uint32_t)m_vecClusters.size();
+
+		if (nEnd - nBegin <= nMaxClusterTriangles)
+		{
+			// Within a cluster triangles keep the order they had in the file
+			std::sort(vecOrder.begin() + nBegin, vecOrder.begin() + nEnd);
+
+			meshCluster c;
+			c.nFirstTriangle = nBegin;
+			c.nTriangleCount = nEnd - nBegin;
+			c.nFirstVertex = 0;
+			c.nVertexCount = 0;
+			for (uint32_t t = nBegin; t < nEnd; t++)
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t v = m.indices[vecOrder[t] * 3 + k];
+					c.bounds.Add(m.verts.x[v], m.verts.y[v], m.verts.z[v]);
+				}
+			m_vecClusters.push_back(c);
+			m_vecNodes[nNode].bounds = c.bounds;
+			m_vecNodes[nNode].nClusterCount = 1;
+			return;
+		}
+
+		aabb centroids;
+		for (uint32_t t = nBegin; t < nEnd; t++)
+			centroids.Add(vecCentroids[vecOrder[t] * 3], vecCentroids[vecOrder[t] * 3 + 1], vecCentroids[vecOrder[t] * 3 + 2]);
+		int nAxis = centroids.LongestAxis();
+
+		// Ties broken by triangle number so the halves are the same on every standard library
+		uint32_t nMid = nBegin + (nEnd - nBegin) / 2;
+		std::nth_element(vecOrder.begin() + nBegin, vecOrder.begin() + nMid, vecOrder.begin() + nEnd, [&](uint32_t a, uint32_t b)
+		{
+			float fa = vecCentroids[a * 3 + nAxis], fb = vecCentroids[b * 3 + nAxis];
+			return fa < fb || (fa == fb && a < b);
+		});
+
+		uint32_t nChild = (uint32_t)m_vecNodes.size();
+		m_vecNodes[nNode].nChild = nChild;
+		m_vecNodes.emplace_back();
+		m_vecNodes.emplace_back();
+		BuildNode(nChild, m, vecOrder, vecCentroids, nBegin, nMid, nMaxClusterTriangles);
+		BuildNode(nChild + 1, m, vecOrder, vecCentroids, nMid, nEnd, nMaxClusterTriangles);
+
+		bvhNode& node = m_vecNodes[nNode];
+		node.bounds = m_vecNodes[nChild].bounds;
+		node.bounds.Add(m_vecNodes[nChild + 1].bounds);
+		node.nClusterCount = (uint32_t)m_vecClusters.size() - node.nFirstCluster;
+	}
+
+	std::vector<bvhNode> m_vecNodes;
+	std::vector<meshCluster> m_vecClusters;
+};
+
+#endif
@@ -0,0 +1,491 @@
+#pragma once
+
+#ifndef CONSOLE_BACKEND_H
+#define CONSOLE_BACKEND_H
+
+// Platform layer for olcConsoleGameEngine. The engine itself only ever touches
+// m_bufScreen and the key/mouse state arrays; everything that talks to an actual
+// console (creating it, polling input, presenting a frame, setting the title) is
+// routed through an olcConsoleBackend so that the renderer can also be driven on
+// machines without a Windows console.
+
+#ifdef _WIN32
+
+#pragma comment(lib, "winmm.lib")
+
+#ifndef UNICODE
+#error Please enable UNICODE for your compiler! VS: Project Properties -> General -> \
+Character Set -> Use Unicode. Thanks! - Javidx9
+#endif
+
+#include <windows.h>
+
+#else
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+
+// Minimal stand-ins for the Win32 types the engine uses. CHAR_INFO keeps the
+// Windows layout (16-bit glyph + 16-bit attribute) so a frame is bit-identical
+// whichever platform rendered it.
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef uint16_t WCHAR;
+
+struct CHAR_INFO
+{
+	union
+	{
+		WCHAR UnicodeChar;
+		char AsciiChar;
+	} Char;
+	WORD Attributes;
+};
+
+struct COORD { short X; short Y; };
+struct SMALL_RECT { short Left; short Top; short Right; short Bottom; };
+
+struct WAVEFORMATEX
+{
+	WORD wFormatTag;
+	WORD nChannels;
+	DWORD nSamplesPerSec;
+	DWORD nAvgBytesPerSec;
+	WORD nBlockAlign;
+	WORD wBitsPerSample;
+	WORD cbSize;
+};
+
+#define MAXSHORT 0x7fff
+
+// Virtual key codes, same values as winuser.h
+#define VK_LBUTTON 0x01
+#define VK_RBUTTON 0x02
+#define VK_MBUTTON 0x04
+#define VK_BACK 0x08
+#define VK_TAB 0x09
+#define VK_RETURN 0x0D
+#define VK_SHIFT 0x10
+#define VK_CONTROL 0x11
+#define VK_MENU 0x12
+#define VK_ESCAPE 0x1B
+#define VK_SPACE 0x20
+#define VK_PRIOR 0x21
+#define VK_NEXT 0x22
+#define VK_END 0x23
+#define VK_HOME 0x24
+#define VK_LEFT 0x25
+#define VK_UP 0x26
+#define VK_RIGHT 0x27
+#define VK_DOWN 0x28
+#define VK_INSERT 0x2D
+#define VK_DELETE 0x2E
+#define VK_F1 0x70
+#define VK_LSHIFT 0xA0
+#define VK_RSHIFT 0xA1
+#define VK_LCONTROL 0xA2
+#define VK_RCONTROL 0xA3
+#define VK_LMENU 0xA4
+#define VK_RMENU 0xA5
+
+inline int _wfopen_s(FILE** f, const wchar_t* sFile, const wchar_t* sMode)
+{
+	std::wstring ws(sFile), wm(sMode);
+	std::string file(ws.begin(), ws.end()), mode(wm.begin(), wm.end());
+	*f = std::fopen(file.c_str(), mode.c_str());
+	return *f == nullptr ? 1 : 0;
+}
+
+#endif
+
+#include "inputQueue.h"
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+
+// Wall-clock time spent in each part of GameThread, accumulated over the run
+struct olcFrameTimings
+{
+	uint64_t nFrames = 0;
+	double dTotalTime = 0.0;
+	double dInputTime = 0.0;
+	double dUpdateTime = 0.0;
+	double dPresentTime = 0.0;
+
+	// Only filled in when frames are presented on their own thread, in which case
+	// dPresentTime is the game thread's share: handing the frame over
+	bool bPipelined = false;
+	uint64_t nFramesPresented = 0;
+	uint64_t nFramesDropped = 0;
+	double dPresentBusyTime = 0.0; // Presenter thread inside Present
+	double dHandoffWaitTime = 0.0; // Game thread waiting for the presenter to take a frame
+
+	// Only filled in with a fixed simulation step or a frame cap
+	bool bPaced = false;
+	uint64_t nTicks = 0; // Fixed steps simulated
+	double dDroppedTime = 0.0; // Simulation time skipped when too far behind
+	double dSleepTime = 0.0; // Waiting for the frame cap
+	double dIntervalSum = 0.0; // Start of one frame to the next
+	double dIntervalSqSum = 0.0;
+	double dMaxInterval = 0.0;
+};
+
+class olcConsoleBackend
+{
+public:
+	virtual ~olcConsoleBackend() {}
+
+	// Create the output surface, returns false (after reporting why) on failure
+	virtual bool Construct(int width, int height, int fontw, int fonth) = 0;
+
+	// Hand over the input state as of now. Key states follow GetAsyncKeyState,
+	// i.e. 0x8000 set while held
+	virtual void PollInput(short* keyStates, bool* mouseStates, int& mouseX, int& mouseY, bool& bFocused) = 0;
+
+	// Show a finished frame
+	virtual void Present(const CHAR_INFO* buf, int width, int height) = 0;
+
+	virtual void SetTitle(const std::wstring& sTitle) = 0;
+
+	// Polled once per frame, lets a backend end the game loop on its own
+	virtual bool KeepRunning() { return true; }
+
+	// Called once the game loop has exited and the user permitted destruction
+	virtual void Shutdown(const olcFrameTimings& /*timings*/) {}
+};
+
+#ifdef _WIN32
+
+class olcWindowsConsoleBackend : public olcConsoleBackend
+{
+public:
+	olcWindowsConsoleBackend()
+	{
+		m_hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
+		m_hConsoleIn = GetStdHandle(STD_INPUT_HANDLE);
+		m_hOriginalConsole = m_hConsole;
+	}
+
+	~olcWindowsConsoleBackend()
+	{
+		StopInput();
+		SetConsoleActiveScreenBuffer(m_hOriginalConsole);
+	}
+
+	bool Construct(int width, int height, int fontw, int fonth) override
+	{
+		if (m_hConsole == INVALID_HANDLE_VALUE)
+			return Error(L"Bad Handle");
+
+		// Update 13/09/2017 - It seems that the console behaves differently on some systems
+		// and I'm unsure why this is. It could be to do with windows default settings, or
+		// screen resolutions, or system languages. Unfortunately, MSDN does not offer much
+		// by way of useful information, and so the resulting sequence is the reult of experiment
+		// that seems to work in multiple cases.
+		//
+		// The problem seems to be that the SetConsoleXXX functions are somewhat circular and
+		// fail depending on the state of the current console properties, i.e. you can't set
+		// the buffer size until you set the screen size, but you can't change the screen size
+		// until the buffer size is correct. This coupled with a precise ordering of calls
+		// makes this procedure seem a little mystical :-P. Thanks to wowLinh for helping - Jx9
+
+		// Change console visual size to a minimum so ScreenBuffer can shrink
+		// below the actual visual size
+		m_rectWindow = { 0, 0, 1, 1 };
+		SetConsoleWindowInfo(m_hConsole, TRUE, &m_rectWindow);
+
+		// Set the size of the screen buffer
+		COORD coord = { (short)width, (short)height };
+		if (!SetConsoleScreenBufferSize(m_hConsole, coord))
+			Error(L"SetConsoleScreenBufferSize");
+
+		// Assign screen buffer to the console
+		if (!SetConsoleActiveScreenBuffer(m_hConsole))
+			return Error(L"SetConsoleActiveScreenBuffer");
+
+		// Set the font size now that the screen buffer has been assigned to the console
+		CONSOLE_FONT_INFOEX cfi;
+		cfi.cbSize = sizeof(cfi);
+		cfi.nFont = 0;
+		cfi.dwFontSize.X = fontw;
+		cfi.dwFontSize.Y = fonth;
+		cfi.FontFamily = FF_DONTCARE;
+		cfi.FontWeight = FW_NORMAL;
+
+		/*	DWORD version = GetVersion();
+			DWORD major = (DWORD)(LOBYTE(LOWORD(version)));
+			DWORD minor = (DWORD)(HIBYTE(LOWORD(version)));*/
+
+			//if ((major > 6) || ((major == 6) && (minor >= 2) && (minor < 4)))
+			//	wcscpy_s(cfi.FaceName, L"Raster"); // Windows 8 :(
+			//else
+			//	wcscpy_s(cfi.FaceName, L"Lucida Console"); // Everything else :P
+
+			//wcscpy_s(cfi.FaceName, L"Liberation Mono");
+		wcscpy_s(cfi.FaceName, L"Consolas");
+		if (!SetCurrentConsoleFontEx(m_hConsole, false, &cfi))
+			return Error(L"SetCurrentConsoleFontEx");
+
+		// Get screen buffer info and check the maximum allowed window size. Return
+		// error if exceeded, so user knows their dimensions/fontsize are too large
+		CONSOLE_SCREEN_BUFFER_INFO csbi;
+		if (!GetConsoleScreenBufferInfo(m_hConsole, &csbi))
+			return Error(L"GetConsoleScreenBufferInfo");
+		if (height > csbi.dwMaximumWindowSize.Y)
+			return Error(L"Screen Height / Font Height Too Big");
+		if (width > csbi.dwMaximumWindowSize.X)
+			return Error(L"Screen Width / Font Width Too Big");
+
+		// Set Physical Console Window Size
+		m_rectWindow = { 0, 0, (short)width - 1, (short)height - 1 };
+		if (!SetConsoleWindowInfo(m_hConsole, TRUE, &m_rectWindow))
+			return Error(L"SetConsoleWindowInfo");
+
+		// Set flags to allow mouse input
+		if (!SetConsoleMode(m_hConsoleIn, ENABLE_EXTENDED_FLAGS | ENABLE_WINDOW_INPUT | ENABLE_MOUSE_INPUT))
+			return Error(L"SetConsoleMode");
+
+		m_bReading = true;
+		m_threadInput = std::thread(&olcWindowsConsoleBackend::InputThread, this);
+		return true;
+	}
+
+	void PollInput(short* keyStates, bool* mouseStates, int& mouseX, int& mouseY, bool& bFocused) override
+	{
+		m_input.Drain(keyStates, mouseStates, mouseX, mouseY, bFocused);
+	}
+
+	void Present(const CHAR_INFO* buf, int width, int height) override
+	{
+		WriteConsoleOutput(m_hConsole, buf, { (short)width, (short)height }, { 0,0 }, &m_rectWindow);
+	}
+
+	void SetTitle(const std::wstring& sTitle) override
+	{
+		SetConsoleTitle(sTitle.c_str());
+	}
+
+	void Shutdown(const olcFrameTimings& /*timings*/) override
+	{
+		StopInput();
+		SetConsoleActiveScreenBuffer(m_hOriginalConsole);
+	}
+
+protected:
+	// Blocks on the console input handle and forwards every record as it arrives.
+	// The wait times out now and then so StopInput never has to wait long.
+	void InputThread()
+	{
+		INPUT_RECORD inBuf[64];
+		bool bKeyDown[256] = {};
+		DWORD nButtons = 0;
+		COORD posMouse = { -1, -1 };
+
+		auto pushKey = [&](int k, bool bDown)
+		{
+			if (k <= 0 || k > 255 || bKeyDown[k] == bDown)
+				return;
+			bKeyDown[k] = bDown;
+			inputEvent e;
+			e.nType = INPUT_KEY;
+			e.nCode = (uint8_t)k;
+			e.bDown = bDown;
+			m_input.Push(e);
+		};
+
+		while (m_bReading)
+		{
+			if (WaitForSingleObject(m_hConsoleIn, 50) != WAIT_OBJECT_0)
+				continue;
+
+			DWORD events = 0;
+			if (!ReadConsoleInput(m_hConsoleIn, inBuf, 64, &events))
+				continue;
+
+			for (DWORD i = 0; i < events; i++)
+			{
+				switch (inBuf[i].EventType)
+				{
+				case KEY_EVENT:
+				{
+					const KEY_EVENT_RECORD& key = inBuf[i].Event.KeyEvent;
+					int k = key.wVirtualKeyCode;
+					pushKey(k, key.bKeyDown != FALSE);
+
+					// Console records only carry the generic modifier codes, while
+					// GetAsyncKeyState also reported which side was used
+					if (k == VK_SHIFT)
+						pushKey(MapVirtualKey(key.wVirtualScanCode, MAPVK_VSC_TO_VK_EX), key.bKeyDown != FALSE);
+					else if (k == VK_CONTROL)
+						pushKey((key.dwControlKeyState & ENHANCED_KEY) ? VK_RCONTROL : VK_LCONTROL, key.bKeyDown != FALSE);
+					else if (k == VK_MENU)
+						pushKey((key.dwControlKeyState & ENHANCED_KEY) ? VK_RMENU : VK_LMENU, key.bKeyDown != FALSE);
+				}
+				break;
+
+				case FOCUS_EVENT:
+				{
+					inputEvent e;
+					e.nType = INPUT_FOCUS;
+					e.bDown = inBuf[i].Event.FocusEvent.bSetFocus != FALSE;
+					m_input.Push(e);
+
+					// Key ups that happen elsewhere never reach this console
+					if (!e.bDown)
+						for (int k = 0; k < 256; k++)
+							pushKey(k, false);
+				}
+				break;
+
+				case MOUSE_EVENT:
+				{
+					const MOUSE_EVENT_RECORD& mouse = inBuf[i].Event.MouseEvent;
+					if (mouse.dwEventFlags != 0 && mouse.dwEventFlags != MOUSE_MOVED)
+						break; // Wheel and double clicks
+
+					if (mouse.dwMousePosition.X != posMouse.X || mouse.dwMousePosition.Y != posMouse.Y)
+					{
+						posMouse = mouse.dwMousePosition;
+						inputEvent e;
+						e.nType = INPUT_MOUSE_MOVE;
+						e.x = posMouse.X;
+						e.y = posMouse.Y;
+						m_input.Push(e);
+					}
+
+					for (int m = 0; m < 5; m++)
+					{
+						bool bDown = (mouse.dwButtonState & (1 << m)) != 0;
+						if (bDown == ((nButtons & (1 << m)) != 0))
+							continue;
+						inputEvent e;
+						e.nType = INPUT_MOUSE_BUTTON;
+						e.nCode = (uint8_t)m;
+						e.bDown = bDown;
+						m_input.Push(e);
+					}
+					nButtons = mouse.dwButtonState;
+				}
+				break;
+
+				default:
+					break;
+				}
+			}
+		}
+	}
+
+	void StopInput()
+	{
+		m_bReading = false;
+		if (m_threadInput.joinable())
+			m_threadInput.join();
+	}
+
+	int Error(const wchar_t* msg)
+	{
+		wchar_t buf[256];
+		FormatMessage(FORMAT_MESSAGE_FROM_SYSTEM, NULL, GetLastError(), MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), buf, 256, NULL);
+		SetConsoleActiveScreenBuffer(m_hOriginalConsole);
+		wprintf(L"ERROR: %s\n\t%s\n", msg, buf);
+		return 0;
+	}
+
+	HANDLE m_hOriginalConsole;
+	HANDLE m_hConsole;
+	HANDLE m_hConsoleIn;
+	SMALL_RECT m_rectWindow;
+
+	inputQueue m_input;
+	std::thread m_threadInput;
+	std::atomic<bool> m_bReading{ false };
+};
+
+#endif
+
+// Renders into m_bufScreen and throws the frame away. No input ever arrives, so
+// the game loop runs flat out; useful for profiling on boxes without a console.
+// nMaxFrames = 0 runs until the user's OnUserUpdate returns false.
+class olcHeadlessBackend : public olcConsoleBackend
+{
+public:
+	olcHeadlessBackend(uint64_t nMaxFrames = 0, bool bReport = true)
+	{
+		m_nMaxFrames = nMaxFrames;
+		m_bReport = bReport;
+	}
+
+	bool Construct(int /*width*/, int /*height*/, int /*fontw*/, int /*fonth*/) override
+	{
+		return true;
+	}
+
+	void PollInput(short* keyStates, bool* /*mouseStates*/, int& /*mouseX*/, int& /*mouseY*/, bool& /*bFocused*/) override
+	{
+		for (int i = 0; i < 256; i++)
+			keyStates[i] = 0;
+	}
+
+	void Present(const CHAR_INFO* /*buf*/, int /*width*/, int /*height*/) override
+	{
+		m_nFramesPresented++;
+	}
+
+	void SetTitle(const std::wstring& /*sTitle*/) override
+	{
+	}
+
+	bool KeepRunning() override
+	{
+		return m_nMaxFrames == 0 || m_nFramesPresented < m_nMaxFrames;
+	}
+
+	void Shutdown(const olcFrameTimings& timings) override
+	{
+		if (!m_bReport || timings.nFrames == 0)
+			return;
+
+		double n = (double)timings.nFrames;
+		printf("Headless run: %llu frames in %.3f s (%.2f FPS)\n",
+			(unsigned long long)timings.nFrames, timings.dTotalTime, n / timings.dTotalTime);
+		printf("  input   %8.4f ms/frame\n", 1000.0 * timings.dInputTime / n);
+		printf("  update  %8.4f ms/frame\n", 1000.0 * timings.dUpdateTime / n);
+		printf("  present %8.4f ms/frame\n", 1000.0 * timings.dPresentTime / n);
+		if (timings.bPipelined)
+		{
+			// Present time the game thread did not spend waiting ran alongside rendering
+			double dOverlap = timings.dPresentBusyTime - timings.dHandoffWaitTime;
+			printf("  presenter thread: %llu presented, %llu dropped, busy %.4f ms/frame, game waited %.4f ms/frame, overlap %.0f%%\n",
+				(unsigned long long)timings.nFramesPresented, (unsigned long long)timings.nFramesDropped,
+				1000.0 * timings.dPresentBusyTime / n, 1000.0 * timings.dHandoffWaitTime / n,
+				timings.dPresentBusyTime > 0.0 ? 100.0 * (dOverlap > 0.0 ? dOverlap : 0.0) / timings.dPresentBusyTime : 0.0);
+		}
+		if (timings.bPaced)
+		{
+			// The game thread is busy whenever it is not waiting for the frame cap
+			double nIntervals = n > 1.0 ? n - 1.0 : 1.0;
+			double dMean = timings.dIntervalSum / nIntervals;
+			double dJitter = sqrt(std::max(0.0, timings.dIntervalSqSum / nIntervals - dMean * dMean));
+			printf("  paced: %llu ticks (%.2f/frame), %.3f s of simulation dropped, busy %.1f%% of the time\n",
+				(unsigned long long)timings.nTicks, timings.nTicks / n, timings.dDroppedTime,
+				timings.dTotalTime > 0.0 ? 100.0 * (1.0 - timings.dSleepTime / timings.dTotalTime) : 0.0);
+			printf("  frame interval %.4f ms, jitter %.4f ms, worst %.4f ms\n", 1000.0 * dMean, 1000.0 * dJitter, 1000.0 * timings.dMaxInterval);
+		}
+	}
+
+	uint64_t FramesPresented() { return m_nFramesPresented; }
+
+protected:
+	uint64_t m_nMaxFrames = 0;
+	uint64_t m_nFramesPresented = 0;
+	bool m_bReport = true;
+};
+
+#endif
@@ -0,0 +1,239 @@
+#pragma once
+
+#ifndef EDGE_RASTERIZER_H
+#define EDGE_RASTERIZER_H
+
+#include "consoleBackend.h"
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EDGE_RASTERIZER_SSE2
+#include <emmintrin.h>
+#endif
+
+// Half-space triangle rasterization. A cell is covered when its centre lies
+// inside all three edges of the triangle. Vertices are snapped to a fixed point
+// grid of 1/16th of a cell, so the edge functions are exact integers, and cells
+// exactly on an edge belong to the triangle only if that is a top or left edge.
+// Triangles sharing an edge therefore cover every cell along it exactly once.
+// Coordinates must stay within a few hundred cells of the screen, which the
+// guard band clipper guarantees.
+
+const int nEdgeSubBits = 4;
+const int nEdgeSubSteps = 1 << nEdgeSubBits;
+
+// Depth as a plane over the screen, z = A * x + B * y + C, from three vertices
+// carrying 1/w. Degenerate triangles get a flat plane at their nearest vertex.
+struct depthPlane
+{
+	float A, B, C;
+
+	depthPlane(float x1, float y1, float z1, float x2, float y2, float z2, float x3, float y3, float z3)
+	{
+		A = 0.0f;
+		B = 0.0f;
+		C = fmaxf(z1, fmaxf(z2, z3));
+		float det = (x2 - x1) * (y3 - y1) - (x3 - x1) * (y2 - y1);
+		if (fabsf(det) > 1e-6f)
+		{
+			A = ((z2 - z1) * (y3 - y1) - (z3 - z1) * (y2 - y1)) / det;
+			B = ((x2 - x1) * (z3 - z1) - (x3 - x1) * (z2 - z1)) / det;
+			C = z1 - A * x1 - B * y1;
+		}
+	}
+};
+
+// Edge function of one edge, set up so that it is >= 0 on the covered side
+struct edgeFunction
+{
+	int32_t nStepX; // Change for one cell to the right
+	int32_t nBias;  // 0 on top-left edges, -1 elsewhere so ties go to the neighbour
+
+	int64_t nX0, nY0, nDX, nDY;
+
+	void Setup(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+	{
+		nX0 = x0; nY0 = y0;
+		nDX = (int64_t)x1 - x0;
+		nDY = (int64_t)y1 - y0;
+		nStepX = (int32_t)(-nDY * nEdgeSubSteps);
+
+		// With y growing down and the triangle wound clockwise on screen, a top edge
+		// is horizontal and runs right, a left edge runs up
+		bool bTopLeft = (nDY == 0 && nDX > 0) || nDY < 0;
+		nBias = bTopLeft ? 0 : -1;
+	}
+
+	// Value at the centre of cell (i, j)
+	int32_t At(int i, int j) const
+	{
+		int64_t px = (int64_t)i * nEdgeSubSteps + nEdgeSubSteps / 2;
+		int64_t py = (int64_t)j * nEdgeSubSteps + nEdgeSubSteps / 2;
+		return (int32_t)(nDX * (py - nY0) - nDY * (px - nX0) + nBias);
+	}
+};
+
+// Sets up the three edges of a triangle and the cells [x0, x1] x [y0, y1] that
+// may be covered, clipped to the scissor rectangle [sx1, sx2) x [sy1, sy2).
+// Returns false when nothing can be covered.
+inline bool SetupEdgeTriangle(float x1, float y1, float x2, float y2, float x3, float y3,
+	int sx1, int sy1, int sx2, int sy2, edgeFunction (&e)[3], int& cx0, int& cy0, int& cx1, int& cy1)
+{
+	int32_t X[3] = { (int32_t)lrintf(x1 * nEdgeSubSteps), (int32_t)lrintf(x2 * nEdgeSubSteps), (int32_t)lrintf(x3 * nEdgeSubSteps) };
+	int32_t Y[3] = { (int32_t)lrintf(y1 * nEdgeSubSteps), (int32_t)lrintf(y2 * nEdgeSubSteps), (int32_t)lrintf(y3 * nEdgeSubSteps) };
+
+	int64_t nArea = ((int64_t)X[1] - X[0]) * ((int64_t)Y[2] - Y[0]) - ((int64_t)X[2] - X[0]) * ((int64_t)Y[1] - Y[0]);
+	if (nArea == 0)
+		return false;
+
+	// Wind every triangle the same way so "inside" is always >= 0
+	if (nArea < 0)
+	{
+		std::swap(X[1], X[2]);
+		std::swap(Y[1], Y[2]);
+	}
+
+	e[0].Setup(X[0], Y[0], X[1], Y[1]);
+	e[1].Setup(X[1], Y[1], X[2], Y[2]);
+	e[2].Setup(X[2], Y[2], X[0], Y[0]);
+
+	// Cells whose centres lie within the bounds of the snapped vertices
+	auto FloorDiv = [](int32_t v) { return v >= 0 ? v / nEdgeSubSteps : -((-v + nEdgeSubSteps - 1) / nEdgeSubSteps); };
+	const int32_t nHalf = nEdgeSubSteps / 2;
+	int32_t minX = std::min(X[0], std::min(X[1], X[2])), maxX = std::max(X[0], std::max(X[1], X[2]));
+	int32_t minY = std::min(Y[0], std::min(Y[1], Y[2])), maxY = std::max(Y[0], std::max(Y[1], Y[2]));
+	cx0 = std::max(-FloorDiv(nHalf - minX), sx1);
+	cx1 = std::min(FloorDiv(maxX - nHalf), sx2 - 1);
+	cy0 = std::max(-FloorDiv(nHalf - minY), sy1);
+	cy1 = std::min(FloorDiv(maxY - nHalf), sy2 - 1);
+	return cx0 <= cx1 && cy0 <= cy1;
+}
+
+// Generic version: plot(i, j) is called for every covered cell that passes the
+// depth test, after its depth has been written
+template <typename PLOT>
+void RasterizeEdgeTriangleScalar(float x1, float y1, float z1, float x2, float y2, float z2, float x3, float y3, float z3,
+	float* pDepth, int nPitch, int sx1, int sy1, int sx2, int sy2, PLOT plot)
+{
+	edgeFunction e[3];
+	int cx0, cy0, cx1, cy1;
+	if (!SetupEdgeTriangle(x1, y1, x2, y2, x3, y3, sx1, sy1, sx2, sy2, e, cx0, cy0, cx1, cy1))
+		return;
+
+	depthPlane plane(x1, y1, z1, x2, y2, z2, x3, y3, z3);
+	for (int j = cy0; j <= cy1; j++)
+	{
+		int32_t w0 = e[0].At(cx0, j), w1 = e[1].At(cx0, j), w2 = e[2].At(cx0, j);
+		float zRow = plane.B * ((float)j + 0.5f) + plane.C;
+		float* rowDepth = pDepth + j * nPitch;
+		for (int i = cx0; i <= cx1; i++)
+		{
+			if ((w0 | w1 | w2) >= 0)
+			{
+				float z = plane.A * ((float)i + 0.5f) + zRow;
+				if (z > rowDepth[i])
+				{
+					rowDepth[i] = z;
+					plot(i, j);
+				}
+			}
+			w0 += e[0].nStepX;
+			w1 += e[1].nStepX;
+			w2 += e[2].nStepX;
+		}
+	}
+}
+
+// Writes ci straight into the screen buffer, four cells at a time where SSE2 is
+// available. Produces exactly the cells and depths of the scalar version.
+inline void RasterizeEdgeTriangle(float x1, float y1, float z1, float x2, float y2, float z2, float x3, float y3, float z3,
+	CHAR_INFO ci, CHAR_INFO* pScreen, float* pDepth, int nPitch, int sx1, int sy1, int sx2, int sy2)
+{
+#ifdef EDGE_RASTERIZER_SSE2
+	edgeFunction e[3];
+	int cx0, cy0, cx1, cy1;
+	if (!SetupEdgeTriangle(x1, y1, x2, y2, x3, y3, sx1, sy1, sx2, sy2, e, cx0, cy0, cx1, cy1))
+		return;
+
+	depthPlane plane(x1, y1, z1, x2, y2, z2, x3, y3, z3);
+	uint32_t nPattern;
+	memcpy(&nPattern, &ci, 4);
+	const __m128i vPattern = _mm_set1_epi32((int)nPattern);
+	const __m128i vLane = _mm_setr_epi32(0, 1, 2, 3);
+	const __m128 vHalf = _mm_set1_ps(0.5f);
+	const __m128 vA = _mm_set1_ps(plane.A);
+	const __m128i vMinusOne = _mm_set1_epi32(-1);
+	__m128i vStep4[3];
+	for (int k = 0; k < 3; k++)
+		vStep4[k] = _mm_set1_epi32(e[k].nStepX * 4);
+
+	for (int j = cy0; j <= cy1; j++)
+	{
+		float zRow = plane.B * ((float)j + 0.5f) + plane.C;
+		float* rowDepth = pDepth + j * nPitch;
+		CHAR_INFO* rowScreen = pScreen + j * nPitch;
+
+		// Edge values for the first four cells of the row
+		__m128i w[3];
+		for (int k = 0; k < 3; k++)
+		{
+			int32_t nStart = e[k].At(cx0, j);
+			int32_t nStep = e[k].nStepX;
+			w[k] = _mm_setr_epi32(nStart, nStart + nStep, nStart + 2 * nStep, nStart + 3 * nStep);
+		}
+		__m128 vZRow = _mm_set1_ps(zRow);
+
+		int i = cx0;
+		for (; i + 3 <= cx1; i += 4)
+		{
+			__m128i vInside = _mm_or_si128(w[0], _mm_or_si128(w[1], w[2]));
+			int nCovered = ~_mm_movemask_ps(_mm_castsi128_ps(vInside)) & 0xF;
+			if (nCovered)
+			{
+				// Same float operations as the scalar version: A * (i + 0.5) + zRow
+				__m128 vX = _mm_add_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(i), vLane)), vHalf);
+				__m128 vZ = _mm_add_ps(_mm_mul_ps(vA, vX), vZRow);
+				__m128 vDepth = _mm_loadu_ps(rowDepth + i);
+				__m128 vPass = _mm_and_ps(_mm_cmpgt_ps(vZ, vDepth), _mm_castsi128_ps(_mm_cmpgt_epi32(vInside, vMinusOne)));
+				if (_mm_movemask_ps(vPass))
+				{
+					_mm_storeu_ps(rowDepth + i, _mm_or_ps(_mm_and_ps(vPass, vZ), _mm_andnot_ps(vPass, vDepth)));
+					__m128i vMask = _mm_castps_si128(vPass);
+					__m128i vOld = _mm_loadu_si128((const __m128i*)(rowScreen + i));
+					_mm_storeu_si128((__m128i*)(rowScreen + i), _mm_or_si128(_mm_and_si128(vMask, vPattern), _mm_andnot_si128(vMask, vOld)));
+				}
+			}
+			for (int k = 0; k < 3; k++)
+				w[k] = _mm_add_epi32(w[k], vStep4[k]);
+		}
+
+		// Up to three cells left over
+		int32_t nW[3] = { _mm_cvtsi128_si32(w[0]), _mm_cvtsi128_si32(w[1]), _mm_cvtsi128_si32(w[2]) };
+		for (; i <= cx1; i++)
+		{
+			if ((nW[0] | nW[1] | nW[2]) >= 0)
+			{
+				float z = plane.A * ((float)i + 0.5f) + zRow;
+				if (z > rowDepth[i])
+				{
+					rowDepth[i] = z;
+					rowScreen[i] = ci;
+				}
+			}
+			for (int k = 0; k < 3; k++)
+				nW[k] += e[k].nStepX;
+		}
+	}
+#else
+	RasterizeEdgeTriangleScalar(x1, y1, z1, x2, y2, z2, x3, y3, z3, pDepth, nPitch, sx1, sy1, sx2, sy2, [&](int i, int j)
+	{
+		pScreen[j * nPitch + i] = ci;
+	});
+#endif
+}
+
+#endif
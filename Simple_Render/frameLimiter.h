@@ -0,0 +1,89 @@
+#pragma once
+
+#ifndef FRAME_LIMITER_H
+#define FRAME_LIMITER_H
+
+#include <chrono>
+#include <thread>
+#include <cmath>
+
+// Holds the game loop to a fixed frame rate by sleeping rather than spinning.
+// Sleeps wake up late by an amount that varies, so the wait is done in short
+// sleeps while there is comfortably more time left than a sleep usually takes,
+// and only the last fraction of a millisecond is spent yielding.
+class frameLimiter
+{
+public:
+	// 0 turns the limit off
+	void SetRate(float fFramesPerSecond)
+	{
+		m_period = std::chrono::duration<double>(fFramesPerSecond > 0.0f ? 1.0 / fFramesPerSecond : 0.0);
+		m_tpNext = std::chrono::steady_clock::now();
+	}
+
+	bool Enabled() const
+	{
+		return m_period.count() > 0.0;
+	}
+
+	// Waits until the current frame's period is over, returning the seconds spent
+	// waiting. A frame that overran starts the next period from now rather than
+	// letting later frames catch up.
+	double Wait()
+	{
+		if (!Enabled())
+			return 0.0;
+
+		auto tpStart = std::chrono::steady_clock::now();
+		m_tpNext += std::chrono::duration_cast<std::chrono::steady_clock::duration>(m_period);
+		if (m_tpNext < tpStart)
+		{
+			m_tpNext = tpStart;
+			return 0.0;
+		}
+
+		SleepUntil(m_tpNext);
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - tpStart).count();
+	}
+
+private:
+	void SleepUntil(std::chrono::steady_clock::time_point tpDeadline)
+	{
+		while (true)
+		{
+			auto tpNow = std::chrono::steady_clock::now();
+			double dRemaining = std::chrono::duration<double>(tpDeadline - tpNow).count();
+			if (dRemaining <= m_dEstimate)
+				break;
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+			// Running mean and deviation of how long a 1 ms sleep really takes
+			double dSlept = std::chrono::duration<double>(std::chrono::steady_clock::now() - tpNow).count();
+			m_nSleeps++;
+			double dDelta = dSlept - m_dMean;
+			m_dMean += dDelta / m_nSleeps;
+			m_dM2 += dDelta * (dSlept - m_dMean);
+			m_dEstimate = m_dMean + sqrt(m_dM2 / m_nSleeps);
+
+			// Forget old samples slowly, so a change in timer resolution is picked up
+			if (m_nSleeps > 1000)
+			{
+				m_nSleeps = 500;
+				m_dM2 *= 0.5;
+			}
+		}
+
+		while (std::chrono::steady_clock::now() < tpDeadline)
+			std::this_thread::yield();
+	}
+
+	std::chrono::duration<double> m_period{ 0.0 };
+	std::chrono::steady_clock::time_point m_tpNext;
+	double m_dEstimate = 0.005; // Seconds a 1 ms sleep is expected to take at worst
+	double m_dMean = 0.005;
+	double m_dM2 = 0.0;
+	uint64_t m_nSleeps = 1;
+};
+
+#endif
@@ -0,0 +1,177 @@
+#pragma once
+
+#ifndef FRAME_PRESENTER_H
+#define FRAME_PRESENTER_H
+
+#include "consoleBackend.h"
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstring>
+
+// Presents frames on a thread of its own so the game thread can draw frame N+1
+// while frame N is still going out to the console. Three screen buffers rotate
+// between the two threads: the one being drawn, the one handed over and waiting,
+// and the one being presented. Handing over is a single atomic exchange of buffer
+// indices; the mutex and condition variable are only there to let a thread sleep
+// when it has nothing to do.
+//
+// Without bDropStale the game thread waits when a frame is already waiting, so
+// it runs at most one frame ahead of the console. With it, a newer frame simply
+// replaces the waiting one, which is then counted as dropped.
+class olcFramePresenter
+{
+public:
+	olcFramePresenter(olcConsoleBackend& backend, int nWidth, int nHeight, bool bDropStale, bool bPreserveFrame)
+		: m_backend(backend)
+	{
+		m_nWidth = nWidth;
+		m_nHeight = nHeight;
+		m_bDropStale = bDropStale;
+		m_bPreserveFrame = bPreserveFrame;
+		for (auto& b : m_vecBuffers)
+			b.resize((size_t)nWidth * nHeight);
+		m_thread = std::thread(&olcFramePresenter::PresentThread, this);
+	}
+
+	~olcFramePresenter()
+	{
+		Stop();
+	}
+
+	olcFramePresenter(const olcFramePresenter&) = delete;
+	olcFramePresenter& operator=(const olcFramePresenter&) = delete;
+
+	// The buffer the game should draw into next, initialised with pFrame
+	CHAR_INFO* Begin(const CHAR_INFO* pFrame)
+	{
+		memcpy(m_vecBuffers[m_nBack].data(), pFrame, m_vecBuffers[m_nBack].size() * sizeof(CHAR_INFO));
+		return m_vecBuffers[m_nBack].data();
+	}
+
+	// Hands the buffer just drawn to the presenter and returns the one to draw
+	// the next frame into. With bPreserveFrame that holds a copy of the frame just
+	// submitted, as games that do not redraw everything expect; without it, it
+	// holds whatever was presented a couple of frames ago.
+	CHAR_INFO* Submit(const std::wstring& sTitle)
+	{
+		m_vecTitles[m_nBack] = sTitle;
+		uint32_t nSubmitted = m_nBack;
+
+		auto tpStart = std::chrono::steady_clock::now();
+		if (!m_bDropStale && (m_nReady.load() & nFresh))
+		{
+			std::unique_lock<std::mutex> lm(m_mux);
+			m_cv.wait(lm, [&] { return !(m_nReady.load() & nFresh) || m_bStopped; });
+		}
+		m_dWaitTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - tpStart).count();
+
+		uint32_t nPrevious = m_nReady.exchange(nSubmitted | nFresh);
+		if (nPrevious & nFresh)
+			m_nDropped++;
+		m_nBack = nPrevious & nIndexMask;
+		Wake();
+
+		if (m_bPreserveFrame)
+			memcpy(m_vecBuffers[m_nBack].data(), m_vecBuffers[nSubmitted].data(), m_vecBuffers[m_nBack].size() * sizeof(CHAR_INFO));
+		return m_vecBuffers[m_nBack].data();
+	}
+
+	// False once the backend has asked to stop
+	bool KeepRunning() const { return m_bKeepRunning.load(); }
+
+	// Presents anything still waiting, then ends the thread
+	void Stop()
+	{
+		if (!m_thread.joinable())
+			return;
+		{
+			std::unique_lock<std::mutex> lm(m_mux);
+			m_bStop = true;
+		}
+		m_cv.notify_all();
+		m_thread.join();
+	}
+
+	// Pacing figures for the timings report, valid after Stop
+	void AddTimings(olcFrameTimings& timings) const
+	{
+		timings.bPipelined = true;
+		timings.nFramesPresented = m_nPresented;
+		timings.nFramesDropped = m_nDropped;
+		timings.dPresentBusyTime = m_dBusyTime;
+		timings.dHandoffWaitTime = m_dWaitTime;
+	}
+
+private:
+	void Wake()
+	{
+		// Taking the lock orders this with a sleeper checking its condition
+		{
+			std::unique_lock<std::mutex> lm(m_mux);
+		}
+		m_cv.notify_all();
+	}
+
+	void PresentThread()
+	{
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lm(m_mux);
+				m_cv.wait(lm, [&] { return (m_nReady.load() & nFresh) || m_bStop; });
+				if (!(m_nReady.load() & nFresh))
+				{
+					m_bStopped = true;
+					break;
+				}
+			}
+
+			m_nFront = m_nReady.exchange(m_nFront) & nIndexMask;
+			Wake();
+
+			auto tpStart = std::chrono::steady_clock::now();
+			m_backend.SetTitle(m_vecTitles[m_nFront]);
+			m_backend.Present(m_vecBuffers[m_nFront].data(), m_nWidth, m_nHeight);
+			if (!m_backend.KeepRunning())
+				m_bKeepRunning = false;
+			m_dBusyTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - tpStart).count();
+			m_nPresented++;
+		}
+		m_cv.notify_all();
+	}
+
+	static const uint32_t nFresh = 4; // Set while the handed over buffer has not been picked up
+	static const uint32_t nIndexMask = 3;
+
+	olcConsoleBackend& m_backend;
+	int m_nWidth;
+	int m_nHeight;
+	bool m_bDropStale;
+	bool m_bPreserveFrame;
+
+	std::vector<CHAR_INFO> m_vecBuffers[3];
+	std::wstring m_vecTitles[3];
+	uint32_t m_nBack = 0; // Game thread only
+	uint32_t m_nFront = 2; // Presenter thread only
+	std::atomic<uint32_t> m_nReady{ 1 };
+
+	std::thread m_thread;
+	std::mutex m_mux;
+	std::condition_variable m_cv;
+	bool m_bStop = false;
+	bool m_bStopped = false;
+	std::atomic<bool> m_bKeepRunning{ true };
+
+	uint64_t m_nDropped = 0;
+	uint64_t m_nPresented = 0;
+	double m_dBusyTime = 0.0;
+	double m_dWaitTime = 0.0;
+};
+
+#endif
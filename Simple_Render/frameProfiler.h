@@ -0,0 +1,252 @@
+#pragma once
+
+#ifndef FRAME_PROFILER_H
+#define FRAME_PROFILER_H
+
+#include <chrono>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstdio>
+
+// Per frame timings of the stages of the pipeline, plus a few counters of the
+// work they did. The last nProfileHistory frames are kept for the overlay; with
+// recording on, every frame is kept until it is written out as CSV or JSON.
+// Everything is meant to be called from the game thread only.
+
+enum PROFILE_STAGE
+{
+	STAGE_CULL,      // Clusters against the frustum and normal cones
+	STAGE_TRANSFORM, // Vertices to view and clip space
+	STAGE_GEOMETRY,  // Backface test, lighting, clipping and projection per triangle
+	STAGE_MERGE,     // Geometry chunks gathered into one list for the rasterizer
+	STAGE_CLEAR,     // Screen and depth buffer clears
+	STAGE_RASTER,    // Triangles into the screen buffer
+	STAGE_PRESENT,   // Frame handed to the backend
+	STAGE_COUNT,
+};
+
+enum PROFILE_COUNTER
+{
+	COUNTER_CLUSTERS,  // Clusters that survived culling
+	COUNTER_VERTICES,  // Vertices transformed
+	COUNTER_TRIANGLES, // Triangles given to the geometry stage
+	COUNTER_RASTER,    // Triangles given to the rasterizer, after clipping
+	COUNTER_CELLS,     // Cells covered by at least one triangle
+	COUNTER_COUNT,
+};
+
+// Names used in the overlay and as CSV columns and JSON keys
+inline const char* ProfileStageName(int nStage)
+{
+	static const char* sNames[STAGE_COUNT] = { "cull", "transform", "geometry", "merge", "clear", "raster", "present" };
+	return sNames[nStage];
+}
+
+inline const char* ProfileCounterName(int nCounter)
+{
+	static const char* sNames[COUNTER_COUNT] = { "clusters", "vertices", "triangles", "raster_triangles", "cells" };
+	return sNames[nCounter];
+}
+
+const size_t nProfileHistory = 256;
+
+struct frameStats
+{
+	double dFrameTime = 0.0; // Start of one frame to the start of the next, in seconds
+	double dStageTime[STAGE_COUNT] = {}; // Seconds
+	uint64_t nCounters[COUNTER_COUNT] = {};
+};
+
+class frameProfiler
+{
+public:
+	// Times one stage of the current frame for as long as it is in scope
+	class scope
+	{
+	public:
+		scope(frameProfiler& profiler, PROFILE_STAGE stage) : m_profiler(profiler), m_stage(stage)
+		{
+			if (m_profiler.m_bEnabled)
+				m_tpStart = std::chrono::steady_clock::now();
+		}
+
+		~scope()
+		{
+			if (m_profiler.m_bEnabled)
+				m_profiler.m_current.dStageTime[m_stage] += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_tpStart).count();
+		}
+
+		scope(const scope&) = delete;
+		scope& operator=(const scope&) = delete;
+
+	private:
+		frameProfiler& m_profiler;
+		PROFILE_STAGE m_stage;
+		std::chrono::steady_clock::time_point m_tpStart;
+	};
+
+	void Enable(bool bEnable)
+	{
+		m_bEnabled = bEnable;
+	}
+
+	bool Enabled() const
+	{
+		return m_bEnabled;
+	}
+
+	// Keep every frame for WriteCsv and WriteJson, not just the recent history
+	void SetRecording(bool bRecord)
+	{
+		m_bRecording = bRecord;
+	}
+
+	void BeginFrame()
+	{
+		if (!m_bEnabled)
+			return;
+		m_current = frameStats();
+		m_tpFrameStart = std::chrono::steady_clock::now();
+	}
+
+	void EndFrame()
+	{
+		if (!m_bEnabled)
+			return;
+		m_current.dFrameTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_tpFrameStart).count();
+
+		if (m_vecHistory.size() < nProfileHistory)
+			m_vecHistory.push_back(m_current);
+		else
+			m_vecHistory[m_nFrames % nProfileHistory] = m_current;
+		m_nFrames++;
+
+		if (m_bRecording)
+			m_vecRecorded.push_back(m_current);
+	}
+
+	void Count(PROFILE_COUNTER counter, uint64_t n)
+	{
+		m_current.nCounters[counter] += n;
+	}
+
+	// Frames profiled so far
+	uint64_t FrameCount() const
+	{
+		return m_nFrames;
+	}
+
+	// Up to nProfileHistory of the latest frames, nAgo = 0 being the last one finished
+	size_t HistorySize() const
+	{
+		return m_vecHistory.size();
+	}
+
+	const frameStats& History(size_t nAgo) const
+	{
+		return m_vecHistory[(m_nFrames - 1 - nAgo) % nProfileHistory];
+	}
+
+	// Every frame since recording was turned on
+	const std::vector<frameStats>& Recorded() const
+	{
+		return m_vecRecorded;
+	}
+
+	// Mean of the frames in the history
+	frameStats Average() const
+	{
+		frameStats avg;
+		if (m_vecHistory.empty())
+			return avg;
+		for (auto& f : m_vecHistory)
+		{
+			avg.dFrameTime += f.dFrameTime;
+			for (int s = 0; s < STAGE_COUNT; s++)
+				avg.dStageTime[s] += f.dStageTime[s];
+			for (int c = 0; c < COUNTER_COUNT; c++)
+				avg.nCounters[c] += f.nCounters[c];
+		}
+		double n = (double)m_vecHistory.size();
+		avg.dFrameTime /= n;
+		for (int s = 0; s < STAGE_COUNT; s++)
+			avg.dStageTime[s] /= n;
+		for (int c = 0; c < COUNTER_COUNT; c++)
+			avg.nCounters[c] = (uint64_t)(avg.nCounters[c] / n + 0.5);
+		return avg;
+	}
+
+	// One row per recorded frame, times in milliseconds
+	bool WriteCsv(const std::string& sFilename) const
+	{
+		std::ofstream f(sFilename, std::ios::trunc);
+		if (!f.is_open())
+			return false;
+
+		f << "frame,frame_ms";
+		for (int s = 0; s < STAGE_COUNT; s++)
+			f << "," << ProfileStageName(s) << "_ms";
+		for (int c = 0; c < COUNTER_COUNT; c++)
+			f << "," << ProfileCounterName(c);
+		f << "\n";
+
+		char buf[32];
+		for (size_t i = 0; i < m_vecRecorded.size(); i++)
+		{
+			const frameStats& fs = m_vecRecorded[i];
+			f << i;
+			snprintf(buf, sizeof(buf), ",%.4f", 1000.0 * fs.dFrameTime);
+			f << buf;
+			for (int s = 0; s < STAGE_COUNT; s++)
+			{
+				snprintf(buf, sizeof(buf), ",%.4f", 1000.0 * fs.dStageTime[s]);
+				f << buf;
+			}
+			for (int c = 0; c < COUNTER_COUNT; c++)
+				f << "," << fs.nCounters[c];
+			f << "\n";
+		}
+		return f.good();
+	}
+
+	// {"frames": [{"frame": 0, "frame_ms": ..., "stages_ms": {...}, "counters": {...}}, ...]}
+	bool WriteJson(const std::string& sFilename) const
+	{
+		std::ofstream f(sFilename, std::ios::trunc);
+		if (!f.is_open())
+			return false;
+
+		char buf[32];
+		f << "{\"frames\": [\n";
+		for (size_t i = 0; i < m_vecRecorded.size(); i++)
+		{
+			const frameStats& fs = m_vecRecorded[i];
+			snprintf(buf, sizeof(buf), "%.4f", 1000.0 * fs.dFrameTime);
+			f << "  {\"frame\": " << i << ", \"frame_ms\": " << buf << ", \"stages_ms\": {";
+			for (int s = 0; s < STAGE_COUNT; s++)
+			{
+				snprintf(buf, sizeof(buf), "%.4f", 1000.0 * fs.dStageTime[s]);
+				f << (s ? ", " : "") << "\"" << ProfileStageName(s) << "\": " << buf;
+			}
+			f << "}, \"counters\": {";
+			for (int c = 0; c < COUNTER_COUNT; c++)
+				f << (c ? ", " : "") << "\"" << ProfileCounterName(c) << "\": " << fs.nCounters[c];
+			f << "}}" << (i + 1 < m_vecRecorded.size() ? "," : "") << "\n";
+		}
+		f << "]}\n";
+		return f.good();
+	}
+
+private:
+	bool m_bEnabled = false;
+	bool m_bRecording = false;
+	frameStats m_current;
+	std::chrono::steady_clock::time_point m_tpFrameStart;
+	std::vector<frameStats> m_vecHistory;
+	std::vector<frameStats> m_vecRecorded;
+	uint64_t m_nFrames = 0;
+};
+
+#endif
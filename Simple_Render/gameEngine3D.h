@@ -0,0 +1,476 @@
+#pragma once
+
+#ifndef GAME_ENGINE_3D_H
+#define GAME_ENGINE_3D_H
+
+#include "oldConsoleGameEngine.h"
+#include "utils.h"
+#include "transformKernels.h"
+#include "tileRasterizer.h"
+#include "meshCache.h"
+#include "clusterBVH.h"
+#include "cameraPath.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+struct player {
+	vec3d vVelocity;
+	float fMaxVelocity = 20.0f;
+	float fAccelerationV = 0.1f; //Vertical Velocity
+	float fAccelerationH = 1.0f; //Horizontal Velocity
+	float fDecceleration = 0.0f;
+};
+
+class gameEngine3D : public olcConsoleGameEngine
+{
+public:
+	gameEngine3D()
+	{
+		m_sAppName = L"3D Rendering Engine";
+	}
+
+private:
+	std::string sMeshFile = "assets/mountains.obj";
+	bool bMeshGiven = false; // meshDemo was handed over by SetMesh rather than loaded
+	indexedMesh meshDemo;
+	objLoadStats loadStats; // How meshDemo was loaded, reported on exit
+	vertexArrays vertsView, vertsClip; // meshDemo transformed this frame
+	std::vector<float> vertsClipW;
+	clusterBVH bvhDemo; // meshDemo's clusters, each one is a geometry chunk
+	std::vector<uint32_t> vecVisibleClusters;
+	std::vector<std::pair<uint32_t, uint32_t>> vecVisibleVertices; // Vertex ranges the visible clusters use
+	std::vector<std::vector<triangle>> vecGeometryChunks; // Output of each geometry chunk, kept to reuse capacity
+	std::vector<uint32_t> vecChunkTriangles; // Triangles each geometry chunk was given, for the profiler
+	std::vector<triangle> vecTrianglesToRaster;
+	float fGuardBand = 64.0f; // Cells a triangle may overhang the screen before it is clipped
+	float fLodThreshold = 0.5f; // Cells of error a coarser level of detail may show on screen
+	bool bClearAfter = false; // Clear only uncovered cells, after rasterizing
+	workerPool pool;
+	tileRasterizer raster{ pool };
+	mat4x4 matProj;
+	player p;
+	float fYaw = 0;
+	float fPitch = 0;
+	vec3d vCamera = { 0.0f, 10.0f, 0.0f }; // Simplified version of a camera
+	vec3d vCameraPrevious = vCamera; // Camera as the fixed step before last left it
+	float fYawPrevious = 0;
+	float fPitchPrevious = 0;
+	vec3d vLookDir = { 0,0,1 }; // Camera's looking direction
+	vec3d light_direction; // Simple directional light source
+	vec3d vLightModel; // light_direction in model space, for the current frame
+	vec3d vCameraModel; // Camera position in model space, for the current frame
+	float fTheta = 0;
+	const cameraPath* pCameraPath = nullptr; // Flies the camera instead of the keyboard
+	uint64_t nPathFrames = 0;
+	uint64_t nPathFrame = 0;
+
+
+public:
+	// Threads used by the geometry and raster stages, 0 = one per hardware thread
+	void SetThreadCount(int nThreads)
+	{
+		pool.Resize(nThreads);
+	}
+
+	// 0 always draws full detail. Set before the engine starts: the coarser levels
+	// are only built when it is above 0
+	void SetLodThreshold(float fCells)
+	{
+		fLodThreshold = fCells;
+	}
+
+	// Edge function (watertight, top-left rule) instead of scanline triangle fills
+	void SetEdgeRasterizer(bool bEdge)
+	{
+		raster.SetEdgeFunctions(bEdge);
+	}
+
+	// Skip the full screen clear and fill in whatever the triangles did not cover
+	void SetClearAfter(bool bAfter)
+	{
+		bClearAfter = bAfter;
+	}
+
+	const objLoadStats& GetLoadStats() const
+	{
+		return loadStats;
+	}
+
+	// .obj file OnUserCreate loads, through its cache
+	void SetMeshFile(const std::string& sFile)
+	{
+		sMeshFile = sFile;
+	}
+
+	// Render m instead of loading a file
+	void SetMesh(const indexedMesh& m)
+	{
+		meshDemo = m;
+		bMeshGiven = true;
+	}
+
+	// Triangles at full detail, the coarser levels not counted
+	size_t TriangleCount() const
+	{
+		size_t nTriangles = 0;
+		for (const meshCluster& c : bvhDemo.Clusters())
+			nTriangles += c.lods[0].nTriangleCount;
+		return nTriangles;
+	}
+
+	// Follow path over nFrames frames, one step per frame whatever the frame time,
+	// so every run draws the same images. The path must outlive the engine's run.
+	void SetCameraPath(const cameraPath* pPath, uint64_t nFrames)
+	{
+		pCameraPath = pPath;
+		nPathFrames = nFrames;
+		nPathFrame = 0;
+	}
+
+	// 0 clips every triangle crossing a screen edge
+	void SetGuardBand(float fCells)
+	{
+		fGuardBand = fCells;
+	}
+
+	bool OnUserCreate() override
+	{
+		// Creating a simple unit cube (sides length = 1)
+		//vec3d origin = CreateVector(0, 0, 0);
+		//vec3d size = CreateVector(1, 1, 1);
+		//meshDemo = CreateCuboidMesh(origin, size).ToIndexed();
+
+		// Loading a .obj file, through its binary cache after the first run
+		if (!bMeshGiven)
+			LoadObjFileCached(meshDemo, sMeshFile, &loadStats, &pool);
+
+		// Face normals never change, so they are worked out once here. Then nearby
+		// triangles are grouped so the frustum and the clusters' normal cones can
+		// reject them a cluster at a time.
+		meshDemo.ComputeFaceNormals();
+		bvhDemo.Build(meshDemo);
+
+		// Coarser versions of every cluster for when it is far enough away, not
+		// needed at all with the levels of detail turned off
+		if (fLodThreshold > 0.0f)
+			bvhDemo.BuildLods(meshDemo, &pool);
+
+		// Creating Projection Matrix
+		float fNear = 0.1f;
+		float fFar = 1000.0f;
+		float fFov = 90.0f;
+		float fAspectRatio = (float)ScreenHeight() / (float)ScreenWidth();
+
+		matProj = CreateProjectMatrix(fFov, fAspectRatio, fNear, fFar);
+		return true;
+	}
+
+	void UpdateCameraOnUserInput(vec3d& vCamera, float fElapsedTime)
+	{
+		if (GetKey(VK_SPACE).bHeld)
+			vCamera.y += 8.0f * fElapsedTime;
+		if (GetKey(VK_LSHIFT).bHeld)
+			vCamera.y -= 8.0f * fElapsedTime;
+
+		vec3d vForward = vLookDir * (8.0f * fElapsedTime);
+		mat4x4 mRotateLeft = CreateRotationMatrixY(-3.14159265f/2.0f);
+		mat4x4 mRotateRight = CreateRotationMatrixY(3.14159265f/2.0f);
+		vec3d vForwardLeft;
+		vec3d vForwardRight;
+		MultiplyVectorMatrix(vForward, vForwardLeft, mRotateLeft);
+		MultiplyVectorMatrix(vForward, vForwardRight, mRotateRight);
+		vForwardLeft.y = 0;
+		vForwardRight.y = 0;
+
+		if (GetKey(L'W').bHeld)
+			vCamera += vForward;
+		if (GetKey(L'S').bHeld)
+			vCamera -= vForward;
+		if (GetKey(L'A').bHeld)
+		{
+			vCamera += vForwardLeft;
+		}
+		if (GetKey(L'D').bHeld)
+		{
+			vCamera += vForwardRight;
+		}
+		
+		if (GetKey(VK_RIGHT).bHeld)
+			fYaw += 2.0f * fElapsedTime;
+		if (GetKey(VK_LEFT).bHeld)
+			fYaw -= 2.0f * fElapsedTime;
+		if (GetKey(VK_UP).bHeld)
+			fPitch -= 1.0f * fElapsedTime;
+		if (GetKey(VK_DOWN).bHeld)
+			fPitch += 1.0f * fElapsedTime;
+	}
+
+	// Camera movement in fixed steps, when the engine is set up for them
+	bool OnUserFixedUpdate(float fStep) override
+	{
+		vCameraPrevious = vCamera;
+		fYawPrevious = fYaw;
+		fPitchPrevious = fPitch;
+		UpdateCameraOnUserInput(vCamera, fStep);
+		return true;
+	}
+
+	bool OnUserUpdate(float fElapsedTime) override
+	{
+		if (pCameraPath)
+		{
+			cameraKey key = pCameraPath->At(nPathFrames > 1 ? (float)nPathFrame / (nPathFrames - 1) : 0.0f);
+			vCamera = key.vPosition;
+			fYaw = key.fYaw;
+			fPitch = key.fPitch;
+			nPathFrame++;
+		}
+		else if (GetFixedTimestep() == 0.0f)
+			UpdateCameraOnUserInput(vCamera, fElapsedTime);
+
+		// With a fixed timestep the camera is drawn between where the last two
+		// steps left it, so its motion stays smooth whatever the frame rate
+		vec3d vEye = vCamera;
+		float fEyeYaw = fYaw, fEyePitch = fPitch;
+		if (GetFixedTimestep() > 0.0f && !pCameraPath)
+		{
+			float a = GetInterpolation();
+			vEye.x = vCameraPrevious.x + (vCamera.x - vCameraPrevious.x) * a;
+			vEye.y = vCameraPrevious.y + (vCamera.y - vCameraPrevious.y) * a;
+			vEye.z = vCameraPrevious.z + (vCamera.z - vCameraPrevious.z) * a;
+			fEyeYaw = fYawPrevious + (fYaw - fYawPrevious) * a;
+			fEyePitch = fPitchPrevious + (fPitch - fPitchPrevious) * a;
+		}
+
+		mat4x4 matRotZ, matRotX;
+		//fTheta += 1.0f * fElapsedTime;
+
+		// Rotate in Z
+		matRotZ = CreateRotationMatrixZ(fTheta);
+
+		// Rotate in X
+		matRotX = CreateRotationMatrixX(fTheta * 2.0f);
+
+		// Translate matrix
+		mat4x4 matTrans = CreateTranslationMatrix(0.0f, 0.0f, 2.0f);
+
+		mat4x4 matWorld;
+		matWorld = CreateIdentityMatrix();
+		matWorld = matRotZ * matRotX;
+		matWorld = matTrans;
+
+		// Creating Camera matrix
+		vec3d vUp = { 0, 1, 0 };
+		vec3d vTarget = { 0, 0, 1 };
+		mat4x4 matCameraYawRot = CreateRotationMatrixY(fEyeYaw);
+		vec3d vCustomAxis = ComputeCrossProduct(vUp, vLookDir);
+		NormalizeVector(vCustomAxis);
+
+		//Update Camera properties
+		mat4x4 matCameraPitchRot = CreateRotationMatrixAroundCustomAxis(fEyePitch, vCustomAxis);
+		mat4x4 matCameraRot = matCameraYawRot * matCameraPitchRot;
+		MultiplyVectorMatrix(vTarget, vLookDir, matCameraRot);
+		vTarget = vEye + vLookDir;
+		
+		mat4x4 matCamera = CreatePointAtMatrix(vEye, vTarget, vUp);
+		mat4x4 matView = ComputeQuickInverse(matCamera);
+
+
+		mat4x4 matWorldView = matWorld * matView;
+		mat4x4 matWorldViewProj = matWorldView * matProj;
+
+		// Camera and light in model space, where the face normals live. The world
+		// and view matrices only rotate and translate, so the quick inverse is exact.
+		mat4x4 matModelFromView = ComputeQuickInverse(matWorldView);
+		vCameraModel = { matModelFromView.m[3][0], matModelFromView.m[3][1], matModelFromView.m[3][2], 1.0f };
+
+		frameProfiler& profiler = Profiler();
+		const std::vector<meshCluster>& vecClusters = bvhDemo.Clusters();
+
+		// Clusters wholly outside the view are dropped before any of their vertices
+		// or triangles are touched. The planes are taken straight from the model to
+		// clip space matrix, so the bounds never need transforming.
+		{
+			frameProfiler::scope profile(profiler, STAGE_CULL);
+			frustum view;
+			view.FromMatrix(matWorldViewProj, 4.0f / ScreenWidth(), 4.0f / ScreenHeight());
+
+			vecVisibleClusters.clear();
+			bvhDemo.Cull(view, vCameraModel, vecVisibleClusters);
+		}
+		profiler.Count(COUNTER_CLUSTERS, vecVisibleClusters.size());
+
+		// Every vertex of a visible cluster is transformed once per frame, straight
+		// from model space with pre-concatenated matrices: into view space for
+		// culling, lighting and clipping, and into clip space for projection.
+		// Neighbouring clusters share vertices, so their ranges are merged first.
+		{
+			frameProfiler::scope profile(profiler, STAGE_TRANSFORM);
+			vecVisibleVertices.clear();
+			for (uint32_t c : vecVisibleClusters)
+				vecVisibleVertices.push_back({ vecClusters[c].nFirstVertex, vecClusters[c].nFirstVertex + vecClusters[c].nVertexCount });
+			std::sort(vecVisibleVertices.begin(), vecVisibleVertices.end());
+
+			vertsView.resize(meshDemo.verts.size());
+			vertsClip.resize(meshDemo.verts.size());
+			vertsClipW.resize(meshDemo.verts.size());
+			for (size_t r = 0; r < vecVisibleVertices.size();)
+			{
+				uint32_t nBegin = vecVisibleVertices[r].first, nEnd = vecVisibleVertices[r].second;
+				for (r++; r < vecVisibleVertices.size() && vecVisibleVertices[r].first <= nEnd; r++)
+					nEnd = std::max(nEnd, vecVisibleVertices[r].second);
+
+				TransformVertexRange(meshDemo.verts, vertsView, nBegin, nEnd - nBegin, matWorldView);
+				TransformVertexRange(meshDemo.verts, vertsClip, nBegin, nEnd - nBegin, matWorldViewProj, &vertsClipW);
+				profiler.Count(COUNTER_VERTICES, nEnd - nBegin);
+			}
+		}
+
+		// Light, brought into model space so it can be compared with the face normals
+		light_direction = { 0.0f, 1.0f, -1.0f };
+		NormalizeVector(light_direction);
+		vec3d vLightView;
+		MultiplyDirectionMatrix(light_direction, vLightView, matView);
+		MultiplyDirectionMatrix(vLightView, vLightModel, matModelFromView);
+
+		// Geometry stage: visible clusters are culled, lit, clipped and projected
+		// in parallel, each into its own buffer. Merging the buffers in cluster order
+		// gives exactly the sequence a serial loop would have produced.
+		size_t nChunks = vecVisibleClusters.size();
+		if (vecGeometryChunks.size() < nChunks)
+			vecGeometryChunks.resize(nChunks);
+		vecChunkTriangles.resize(nChunks);
+
+		// Each cluster is drawn at the coarsest level of detail whose error projects
+		// to less than fLodThreshold cells
+		float fCellsPerUnit = std::max(0.5f * ScreenWidth() * matProj.m[0][0], 0.5f * ScreenHeight() * matProj.m[1][1]);
+
+		{
+			frameProfiler::scope profile(profiler, STAGE_GEOMETRY);
+			pool.ParallelFor(nChunks, [&](size_t nChunk)
+			{
+				std::vector<triangle>& out = vecGeometryChunks[nChunk];
+				out.clear();
+
+				uint32_t nCluster = vecVisibleClusters[nChunk];
+				const clusterLod& lod = fLodThreshold > 0.0f ? bvhDemo.SelectLod(nCluster, vCameraModel, fCellsPerUnit, fLodThreshold) : vecClusters[nCluster].lods[0];
+				for (size_t t = lod.nFirstTriangle; t < lod.nFirstTriangle + lod.nTriangleCount; t++)
+					ProcessTriangle(t, out);
+				vecChunkTriangles[nChunk] = lod.nTriangleCount;
+			});
+		}
+
+		{
+			frameProfiler::scope profile(profiler, STAGE_MERGE);
+			vecTrianglesToRaster.clear();
+			for (size_t c = 0; c < nChunks; c++)
+			{
+				vecTrianglesToRaster.insert(vecTrianglesToRaster.end(), vecGeometryChunks[c].begin(), vecGeometryChunks[c].end());
+				profiler.Count(COUNTER_TRIANGLES, vecChunkTriangles[c]);
+			}
+		}
+		profiler.Count(COUNTER_RASTER, vecTrianglesToRaster.size());
+
+		// Clear Screen, the depth buffer resolves visibility so no sorting is needed
+		{
+			frameProfiler::scope profile(profiler, STAGE_CLEAR);
+			ClearDepth();
+			if (!bClearAfter)
+				Clear(PIXEL_SOLID, FG_BLACK);
+		}
+
+		// Rendering triangles, spread over screen tiles
+		{
+			frameProfiler::scope profile(profiler, STAGE_RASTER);
+			raster.Rasterize(*this, vecTrianglesToRaster);
+		}
+
+		// Or clear only the cells the terrain left uncovered
+		if (bClearAfter)
+		{
+			frameProfiler::scope profile(profiler, STAGE_CLEAR);
+			ClearUncovered(PIXEL_SOLID, FG_BLACK);
+		}
+
+		if (profiler.Enabled())
+			profiler.Count(COUNTER_CELLS, CountCoveredCells());
+		return true;
+	}
+
+	// Takes triangle t of meshDemo from its transformed vertices to zero or more
+	// screen space triangles appended to out. Only reads state shared by the frame,
+	// so it can run on any thread.
+	void ProcessTriangle(size_t t, std::vector<triangle>& out)
+	{
+		size_t i = t * 3;
+		triangle triProjected, triViewed;
+
+		// Backface test in model space with the precomputed normal
+		vec3d normal = meshDemo.normals.Get((uint32_t)t);
+		vec3d vCameraRay = meshDemo.verts.Get(meshDemo.indices[i]) - vCameraModel;
+		if (ComputeDotProduct(normal, vCameraRay) >= 0.0f)
+			return;
+
+		// Compute light intensity i.e how similar the normal vector is to the light's direction
+		float light_dp = ComputeDotProduct(normal, vLightModel);
+
+		for (int k = 0; k < 3; k++)
+			triViewed.p[k] = vertsView.Get(meshDemo.indices[i + k]);
+
+		// Getting console colors
+		CHAR_INFO c = GetColour(light_dp);
+		triViewed.col = c.Attributes;
+		triViewed.sym = c.Char.UnicodeChar;
+		triProjected.col = c.Attributes;
+		triProjected.sym = c.Char.UnicodeChar;
+
+		// Triangles entirely in front of the near plane can use the
+		// vertices already projected
+		if (triViewed.p[0].z >= 0.1f && triViewed.p[1].z >= 0.1f && triViewed.p[2].z >= 0.1f)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t v = meshDemo.indices[i + k];
+				triProjected.p[k] = vertsClip.Get(v);
+				triProjected.p[k].w = vertsClipW[v];
+			}
+			EmitProjected(triProjected, out);
+			return;
+		}
+
+		// Clip view triangle against near plane
+		int nClippedTriangles = 0;
+		triangle clipped[2];
+		nClippedTriangles = Triangle_ClipAgainstPlane({ 0.0f, 0.0f, 0.1f }, { 0.0f, 0.0f, 1.0f }, triViewed, clipped[0], clipped[1]);
+
+		for (int n = 0; n < nClippedTriangles; n++)
+		{
+			// Projecting the View Space i.e convert 3D to 2D
+			MultiplyTriangleMatrix(clipped[n], triProjected, matProj);
+			EmitProjected(triProjected, out);
+		}
+	}
+
+	// Perspective divide, keeping 1/w in w for the depth buffer, then on to the
+	// screen where the triangle is clipped against the four edges
+	void EmitProjected(triangle& triProjected, std::vector<triangle>& out)
+	{
+		for (int v = 0; v < 3; v++)
+		{
+			float fInvW = 1.0f / triProjected.p[v].w;
+			triProjected.p[v] = triProjected.p[v] * fInvW;
+			triProjected.p[v].w = fInvW;
+		}
+
+		ScaleToScreenSize(triProjected, (float)ScreenWidth(), (float)ScreenHeight());
+
+		// Clip triangles against all four screen edges, or the guard band around them
+		triangle clipped[nMaxScreenClippedTriangles];
+		int nClipped = Triangle_ClipAgainstScreen(triProjected, (float)ScreenWidth(), (float)ScreenHeight(), clipped, fGuardBand);
+		out.insert(out.end(), clipped, clipped + nClipped);
+	}
+};
+
+#endif
@@ -0,0 +1,203 @@
+#pragma once
+
+#ifndef INPUT_LOG_H
+#define INPUT_LOG_H
+
+#include "mappedFile.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+
+// What the game loop read from the keyboard and mouse on one frame, and the
+// elapsed time OnUserUpdate was given, in the form the backends report them.
+struct inputFrame
+{
+	float fElapsedTime = 0.0f;
+	short nKeyStates[256] = {}; // 0x8000 set while held
+	bool bMouseStates[5] = {};
+	int nMouseX = 0;
+	int nMouseY = 0;
+	bool bFocused = true;
+};
+
+// Binary log of inputFrames, so a session can be played back exactly:
+//
+//   inputLogHeader
+//   per frame:
+//     float fElapsedTime
+//     uint8_t nFlags: mouse buttons in bits 0-4, focus in bit 5, bit 6 if the mouse moved
+//     uint16_t nKeyChanges, then that many key codes whose held state flipped
+//     int16_t x, y, only when the mouse moved
+//
+// Only changes are stored, so a frame where nothing happens takes 7 bytes.
+// Little-endian only, like the mesh cache.
+struct inputLogHeader
+{
+	char sMagic[4];
+	uint32_t nVersion;
+};
+
+const char sInputLogMagic[4] = { 'O', 'L', 'C', 'I' };
+const uint32_t nInputLogVersion = 1;
+
+class inputLogWriter
+{
+public:
+	~inputLogWriter()
+	{
+		Close();
+	}
+
+	bool Open(const std::string& sFile)
+	{
+		m_file.open(sFile, std::ios::binary | std::ios::trunc);
+		if (!m_file.is_open())
+			return false;
+
+		inputLogHeader header;
+		memcpy(header.sMagic, sInputLogMagic, 4);
+		header.nVersion = nInputLogVersion;
+		m_file.write((const char*)&header, sizeof(header));
+		m_last = inputFrame();
+		m_nFrames = 0;
+		return m_file.good();
+	}
+
+	void Write(const inputFrame& f)
+	{
+		uint8_t nFlags = 0;
+		for (int m = 0; m < 5; m++)
+			nFlags |= f.bMouseStates[m] ? (1 << m) : 0;
+		nFlags |= f.bFocused ? 0x20 : 0;
+		bool bMoved = f.nMouseX != m_last.nMouseX || f.nMouseY != m_last.nMouseY;
+		nFlags |= bMoved ? 0x40 : 0;
+
+		uint8_t nChanged[256];
+		uint16_t nKeyChanges = 0;
+		for (int k = 0; k < 256; k++)
+			if ((f.nKeyStates[k] & 0x8000) != (m_last.nKeyStates[k] & 0x8000))
+				nChanged[nKeyChanges++] = (uint8_t)k;
+
+		Put(&f.fElapsedTime, sizeof(float));
+		Put(&nFlags, 1);
+		Put(&nKeyChanges, 2);
+		Put(nChanged, nKeyChanges);
+		if (bMoved)
+		{
+			int16_t nPos[2] = { (int16_t)f.nMouseX, (int16_t)f.nMouseY };
+			Put(nPos, sizeof(nPos));
+		}
+
+		m_last = f;
+		m_nFrames++;
+		if (m_vecBuffer.size() >= 1 << 16)
+			Flush();
+	}
+
+	// False if any of the log could not be written
+	bool Close()
+	{
+		if (!m_file.is_open())
+			return true;
+		Flush();
+		bool bWritten = m_file.good();
+		m_file.close();
+		return bWritten;
+	}
+
+	uint64_t FrameCount() const
+	{
+		return m_nFrames;
+	}
+
+private:
+	void Put(const void* p, size_t n)
+	{
+		m_vecBuffer.insert(m_vecBuffer.end(), (const char*)p, (const char*)p + n);
+	}
+
+	void Flush()
+	{
+		m_file.write(m_vecBuffer.data(), m_vecBuffer.size());
+		m_vecBuffer.clear();
+	}
+
+	std::ofstream m_file;
+	std::vector<char> m_vecBuffer;
+	inputFrame m_last;
+	uint64_t m_nFrames = 0;
+};
+
+class inputLogReader
+{
+public:
+	// False if the file is missing or not an input log of this version
+	bool Open(const std::string& sFile)
+	{
+		if (!m_file.Open(sFile) || m_file.Size() < sizeof(inputLogHeader))
+			return false;
+
+		inputLogHeader header;
+		memcpy(&header, m_file.Data(), sizeof(header));
+		if (memcmp(header.sMagic, sInputLogMagic, 4) != 0 || header.nVersion != nInputLogVersion)
+			return false;
+
+		m_nPos = sizeof(header);
+		m_current = inputFrame();
+		return true;
+	}
+
+	// Next frame of the log, false once it has run out or is cut short
+	bool Read(inputFrame& f)
+	{
+		float fElapsedTime;
+		uint8_t nFlags;
+		uint16_t nKeyChanges;
+		if (!Get(&fElapsedTime, sizeof(float)) || !Get(&nFlags, 1) || !Get(&nKeyChanges, 2) || nKeyChanges > 256)
+			return false;
+		if (m_nPos + nKeyChanges > m_file.Size())
+			return false;
+
+		for (uint16_t i = 0; i < nKeyChanges; i++)
+		{
+			uint8_t k = (uint8_t)m_file.Data()[m_nPos + i];
+			m_current.nKeyStates[k] = (m_current.nKeyStates[k] & 0x8000) ? 0 : (short)0x8000;
+		}
+		m_nPos += nKeyChanges;
+
+		if (nFlags & 0x40)
+		{
+			int16_t nPos[2];
+			if (!Get(nPos, sizeof(nPos)))
+				return false;
+			m_current.nMouseX = nPos[0];
+			m_current.nMouseY = nPos[1];
+		}
+
+		m_current.fElapsedTime = fElapsedTime;
+		for (int m = 0; m < 5; m++)
+			m_current.bMouseStates[m] = (nFlags & (1 << m)) != 0;
+		m_current.bFocused = (nFlags & 0x20) != 0;
+		f = m_current;
+		return true;
+	}
+
+private:
+	bool Get(void* p, size_t n)
+	{
+		if (m_nPos + n > m_file.Size())
+			return false;
+		memcpy(p, m_file.Data() + m_nPos, n);
+		m_nPos += n;
+		return true;
+	}
+
+	mappedFile m_file;
+	size_t m_nPos = 0;
+	inputFrame m_current;
+};
+
+#endif
@@ -0,0 +1,145 @@
+#pragma once
+
+#ifndef INPUT_QUEUE_H
+#define INPUT_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+// Input arrives on a reader thread owned by the backend, which pushes every key,
+// mouse and focus change into a fixed ring as it happens. The game thread drains
+// the ring once a frame and turns it back into the held-state arrays PollInput
+// has always returned, so nothing is polled key by key and nothing that happens
+// between two frames is lost.
+
+enum INPUT_EVENT
+{
+	INPUT_KEY,          // nCode is a virtual key code
+	INPUT_MOUSE_BUTTON, // nCode is 0-4, in the order of the engine's mouse states
+	INPUT_MOUSE_MOVE,   // x and y in screen cells
+	INPUT_FOCUS,
+};
+
+struct inputEvent
+{
+	uint8_t nType = INPUT_KEY;
+	uint8_t nCode = 0;
+	bool bDown = false; // Key or button pressed, or focus gained
+	int16_t x = 0;
+	int16_t y = 0;
+};
+
+// Single producer, single consumer. Push is only ever called from the reader
+// thread and Drain from the game thread; neither locks or allocates.
+class inputQueue
+{
+public:
+	static const size_t nCapacity = 1024; // Power of two
+
+	// False, and the event is counted as dropped, if the game thread has fallen
+	// more than nCapacity events behind
+	bool Push(const inputEvent& e)
+	{
+		size_t nTail = m_nTail.load(std::memory_order_relaxed);
+		if (nTail - m_nHead.load(std::memory_order_acquire) >= nCapacity)
+		{
+			m_nDropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		m_events[nTail & (nCapacity - 1)] = e;
+		m_nTail.store(nTail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Applies the queued events and writes out the resulting state, keys as
+	// GetAsyncKeyState would report them. A key or button only changes once per
+	// drain: anything after a second change stays queued for the next frame, so a
+	// press and release that both land within one frame still show up as bPressed
+	// on one frame and bReleased on the next.
+	void Drain(short* keyStates, bool* mouseStates, int& mouseX, int& mouseY, bool& bFocused)
+	{
+		bool bChanged[256 + 5];
+		memset(bChanged, 0, sizeof(bChanged));
+
+		size_t nHead = m_nHead.load(std::memory_order_relaxed);
+		size_t nTail = m_nTail.load(std::memory_order_acquire);
+		for (; nHead != nTail; nHead++)
+		{
+			const inputEvent& e = m_events[nHead & (nCapacity - 1)];
+			if (e.nType == INPUT_KEY)
+			{
+				if (m_bKeys[e.nCode] != e.bDown)
+				{
+					if (bChanged[e.nCode])
+						break;
+					bChanged[e.nCode] = true;
+					m_bKeys[e.nCode] = e.bDown;
+				}
+			}
+			else if (e.nType == INPUT_MOUSE_BUTTON)
+			{
+				if (e.nCode < 5 && m_bMouse[e.nCode] != e.bDown)
+				{
+					if (bChanged[256 + e.nCode])
+						break;
+					bChanged[256 + e.nCode] = true;
+					m_bMouse[e.nCode] = e.bDown;
+
+					// GetAsyncKeyState reports the mouse buttons under their own key codes
+					static const uint8_t nButtonKeys[5] = { 0x01, 0x02, 0x04, 0x05, 0x06 };
+					m_bKeys[nButtonKeys[e.nCode]] = e.bDown;
+				}
+			}
+			else if (e.nType == INPUT_MOUSE_MOVE)
+			{
+				m_nMouseX = e.x;
+				m_nMouseY = e.y;
+			}
+			else if (e.nType == INPUT_FOCUS)
+			{
+				m_bFocused = e.bDown;
+			}
+		}
+		m_nHead.store(nHead, std::memory_order_release);
+
+		for (int i = 0; i < 256; i++)
+			keyStates[i] = m_bKeys[i] ? (short)0x8000 : 0;
+		for (int m = 0; m < 5; m++)
+			mouseStates[m] = m_bMouse[m];
+		mouseX = m_nMouseX;
+		mouseY = m_nMouseY;
+		bFocused = m_bFocused;
+	}
+
+	uint64_t Pushed() const
+	{
+		return m_nTail.load(std::memory_order_relaxed);
+	}
+
+	uint64_t Dropped() const
+	{
+		return m_nDropped.load(std::memory_order_relaxed);
+	}
+
+private:
+	inputEvent m_events[nCapacity];
+
+	// Padded onto separate cache lines so the two threads do not share one.
+	// alignas would need aligned new for the backends, which C++14 lacks.
+	char m_pad0[64];
+	std::atomic<size_t> m_nHead{ 0 };
+	char m_pad1[64];
+	std::atomic<size_t> m_nTail{ 0 };
+	std::atomic<uint64_t> m_nDropped{ 0 };
+	char m_pad2[64];
+
+	// Game thread only
+	bool m_bKeys[256] = {};
+	bool m_bMouse[5] = {};
+	int m_nMouseX = 0;
+	int m_nMouseY = 0;
+	bool m_bFocused = true;
+};
+
+#endif
@@ -0,0 +1,125 @@
+#pragma once
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of a whole file. The OS pages it in on demand, so nothing is
+// copied until it is actually touched.
+class mappedFile
+{
+public:
+	mappedFile() {}
+
+	~mappedFile()
+	{
+		Close();
+	}
+
+	mappedFile(const mappedFile&) = delete;
+	mappedFile& operator=(const mappedFile&) = delete;
+
+	bool Open(const std::string& sFile)
+	{
+		Close();
+
+#ifdef _WIN32
+		m_hFile = CreateFileA(sFile.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (m_hFile == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_hFile, &size))
+		{
+			Close();
+			return false;
+		}
+		m_nSize = (size_t)size.QuadPart;
+		if (m_nSize == 0)
+			return true;
+
+		m_hMapping = CreateFileMappingA(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (m_hMapping == NULL)
+		{
+			Close();
+			return false;
+		}
+
+		m_pData = (const char*)MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0);
+#else
+		m_fd = open(sFile.c_str(), O_RDONLY);
+		if (m_fd < 0)
+			return false;
+
+		struct stat st;
+		if (fstat(m_fd, &st) != 0)
+		{
+			Close();
+			return false;
+		}
+		m_nSize = (size_t)st.st_size;
+		if (m_nSize == 0)
+			return true;
+
+		void* p = mmap(nullptr, m_nSize, PROT_READ, MAP_PRIVATE, m_fd, 0);
+		m_pData = p == MAP_FAILED ? nullptr : (const char*)p;
+		if (m_pData)
+			madvise(p, m_nSize, MADV_SEQUENTIAL);
+#endif
+		if (m_pData == nullptr)
+		{
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void Close()
+	{
+#ifdef _WIN32
+		if (m_pData)
+			UnmapViewOfFile(m_pData);
+		if (m_hMapping)
+			CloseHandle(m_hMapping);
+		if (m_hFile != INVALID_HANDLE_VALUE)
+			CloseHandle(m_hFile);
+		m_hMapping = NULL;
+		m_hFile = INVALID_HANDLE_VALUE;
+#else
+		if (m_pData)
+			munmap((void*)m_pData, m_nSize);
+		if (m_fd >= 0)
+			close(m_fd);
+		m_fd = -1;
+#endif
+		m_pData = nullptr;
+		m_nSize = 0;
+	}
+
+	const char* Data() const { return m_pData; }
+	size_t Size() const { return m_nSize; }
+
+private:
+#ifdef _WIN32
+	HANDLE m_hFile = INVALID_HANDLE_VALUE;
+	HANDLE m_hMapping = NULL;
+#else
+	int m_fd = -1;
+#endif
+	const char* m_pData = nullptr;
+	size_t m_nSize = 0;
+};
+
+#endif
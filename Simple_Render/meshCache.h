@@ -0,0 +1,198 @@
+#pragma once
+
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "utils.h"
+#include "mappedFile.h"
+#include "parallelObjLoader.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+
+// Binary twin of an .obj file, written next to it as <name>.obj.olcmesh the first
+// time the .obj is parsed and memory mapped on later runs. The blocks are copied
+// out of the mapping into the mesh's vectors: the checksum reads every byte
+// anyway, and the renderer owns and reorders its vertex and index arrays.
+//
+//   meshCacheHeader
+//   float x[nVertices], y[nVertices], z[nVertices]
+//   uint32_t indices[nIndices]
+//   uint64_t checksum of everything between the header and the checksum
+//
+// The header records the size and modification time of the .obj it was built
+// from, so editing the .obj invalidates the cache. Little-endian only.
+struct meshCacheHeader
+{
+	char sMagic[4];
+	uint32_t nVersion;
+	uint64_t nSourceSize;
+	int64_t nSourceTime;
+	uint64_t nVertices;
+	uint64_t nIndices;
+	uint64_t nFaces; // Face lines in the .obj, for the load stats
+	uint64_t nSkippedFaces;
+};
+
+const char sMeshCacheMagic[4] = { 'O', 'L', 'C', 'M' };
+const uint32_t nMeshCacheVersion = 2;
+
+// FNV-1a over 64 bit words, bytes left at the end are folded in one at a time
+uint64_t MeshCacheChecksum(const char* data, size_t n)
+{
+	uint64_t h = 14695981039346656037ull;
+	size_t nWords = n / 8;
+	for (size_t i = 0; i < nWords; i++)
+	{
+		uint64_t w;
+		memcpy(&w, data + i * 8, 8);
+		h = (h ^ w) * 1099511628211ull;
+	}
+	for (size_t i = nWords * 8; i < n; i++)
+		h = (h ^ (unsigned char)data[i]) * 1099511628211ull;
+	return h;
+}
+
+bool GetFileStamp(const std::string& sFile, uint64_t& nSize, int64_t& nTime)
+{
+#ifdef _MSC_VER
+	struct _stat64 st;
+	if (_stat64(sFile.c_str(), &st) != 0)
+		return false;
+#else
+	struct stat st;
+	if (stat(sFile.c_str(), &st) != 0)
+		return false;
+#endif
+	nSize = (uint64_t)st.st_size;
+	nTime = (int64_t)st.st_mtime;
+	return true;
+}
+
+bool SaveMeshCache(const indexedMesh& m, const std::string& sCacheFile, uint64_t nSourceSize, int64_t nSourceTime, const objLoadStats& stats)
+{
+	meshCacheHeader header;
+	memcpy(header.sMagic, sMeshCacheMagic, 4);
+	header.nVersion = nMeshCacheVersion;
+	header.nSourceSize = nSourceSize;
+	header.nSourceTime = nSourceTime;
+	header.nVertices = m.verts.size();
+	header.nIndices = m.indices.size();
+	header.nFaces = stats.nFaces;
+	header.nSkippedFaces = stats.nSkippedFaces;
+
+	// Assemble the body in memory so the checksum is computed over exactly what is written
+	size_t nFloatBytes = m.verts.size() * sizeof(float);
+	size_t nBodyBytes = 3 * nFloatBytes + m.indices.size() * sizeof(uint32_t);
+	std::vector<char> body(nBodyBytes);
+	char* p = body.data();
+	if (nFloatBytes > 0)
+	{
+		memcpy(p, m.verts.x.data(), nFloatBytes); p += nFloatBytes;
+		memcpy(p, m.verts.y.data(), nFloatBytes); p += nFloatBytes;
+		memcpy(p, m.verts.z.data(), nFloatBytes); p += nFloatBytes;
+	}
+	if (!m.indices.empty())
+		memcpy(p, m.indices.data(), m.indices.size() * sizeof(uint32_t));
+	uint64_t nChecksum = MeshCacheChecksum(body.data(), body.size());
+
+	std::ofstream f(sCacheFile, std::ios::binary | std::ios::trunc);
+	if (!f.is_open())
+		return false;
+
+	f.write((const char*)&header, sizeof(header));
+	f.write(body.data(), body.size());
+	f.write((const char*)&nChecksum, sizeof(nChecksum));
+	f.close();
+
+	if (f.fail())
+	{
+		remove(sCacheFile.c_str());
+		return false;
+	}
+	return true;
+}
+
+// Fails if the cache is missing, stale, truncated or corrupt. The face counts
+// recorded from the parse are put in stats.
+bool LoadMeshCache(indexedMesh& m, const std::string& sCacheFile, uint64_t nSourceSize, int64_t nSourceTime, objLoadStats& stats)
+{
+	mappedFile file;
+	if (!file.Open(sCacheFile) || file.Size() < sizeof(meshCacheHeader) + sizeof(uint64_t))
+		return false;
+
+	meshCacheHeader header;
+	memcpy(&header, file.Data(), sizeof(header));
+	if (memcmp(header.sMagic, sMeshCacheMagic, 4) != 0 || header.nVersion != nMeshCacheVersion ||
+		header.nSourceSize != nSourceSize || header.nSourceTime != nSourceTime)
+		return false;
+
+	uint64_t nBodyBytes = header.nVertices * 3 * sizeof(float) + header.nIndices * sizeof(uint32_t);
+	if (file.Size() != sizeof(header) + nBodyBytes + sizeof(uint64_t))
+		return false;
+
+	const char* body = file.Data() + sizeof(header);
+	uint64_t nChecksum;
+	memcpy(&nChecksum, body + nBodyBytes, sizeof(nChecksum));
+	if (MeshCacheChecksum(body, (size_t)nBodyBytes) != nChecksum)
+		return false;
+
+	size_t nFloatBytes = (size_t)header.nVertices * sizeof(float);
+	m.verts.resize((size_t)header.nVertices);
+	m.indices.resize((size_t)header.nIndices);
+	if (nFloatBytes > 0)
+	{
+		memcpy(m.verts.x.data(), body, nFloatBytes); body += nFloatBytes;
+		memcpy(m.verts.y.data(), body, nFloatBytes); body += nFloatBytes;
+		memcpy(m.verts.z.data(), body, nFloatBytes); body += nFloatBytes;
+	}
+	if (header.nIndices > 0)
+		memcpy(m.indices.data(), body, (size_t)header.nIndices * sizeof(uint32_t));
+
+	stats.nFaces = (size_t)header.nFaces;
+	stats.nSkippedFaces = (size_t)header.nSkippedFaces;
+	return true;
+}
+
+// Loads an .obj through its binary cache, parsing it and (re)writing the cache
+// only when there is no valid one. Failing to write the cache is not an error.
+// With a pool the .obj is parsed on all of its threads.
+bool LoadObjFileCached(indexedMesh& m, const std::string& sObjFile, objLoadStats* pStats = nullptr, workerPool* pPool = nullptr)
+{
+	uint64_t nSize = 0;
+	int64_t nTime = 0;
+	if (!GetFileStamp(sObjFile, nSize, nTime))
+		return false;
+
+	auto tpStart = std::chrono::steady_clock::now();
+	std::string sCacheFile = sObjFile + ".olcmesh";
+	objLoadStats stats;
+	if (LoadMeshCache(m, sCacheFile, nSize, nTime, stats))
+	{
+		if (pStats)
+		{
+			*pStats = stats;
+			pStats->nBytes = (size_t)nSize;
+			pStats->nVertices = m.verts.size();
+			pStats->nTriangles = m.TriangleCount();
+			pStats->dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tpStart).count();
+			pStats->bFromCache = true;
+		}
+		return true;
+	}
+
+	m = indexedMesh();
+	stats = objLoadStats();
+	bool bLoaded = pPool ? LoadObjFileParallel(m, sObjFile, *pPool, &stats) : m.LoadFromObjFile(sObjFile, &stats);
+	if (!bLoaded)
+		return false;
+	if (pStats)
+		*pStats = stats;
+
+	SaveMeshCache(m, sCacheFile, nSize, nTime, stats);
+	return true;
+}
+
+#endif
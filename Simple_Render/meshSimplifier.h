@@ -0,0 +1,209 @@
+#pragma once
+
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include "utils.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Quadric error metric simplification (Garland and Heckbert) by half edge
+// collapses: a vertex is merged into one of its neighbours, so no new vertices
+// are made and the simplified triangles index the same vertex arrays.
+
+// Sum of squared distances to a set of planes, as a symmetric 4x4 matrix
+struct quadric
+{
+	double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+	void AddPlane(double a, double b, double c, double d)
+	{
+		a2 += a * a; ab += a * b; ac += a * c; ad += a * d;
+		b2 += b * b; bc += b * c; bd += b * d;
+		c2 += c * c; cd += c * d;
+		d2 += d * d;
+	}
+
+	void Add(const quadric& q)
+	{
+		a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+		b2 += q.b2; bc += q.bc; bd += q.bd;
+		c2 += q.c2; cd += q.cd;
+		d2 += q.d2;
+	}
+
+	double Evaluate(double x, double y, double z) const
+	{
+		double r = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+			+ b2 * y * y + 2 * bc * y * z + 2 * bd * y
+			+ c2 * z * z + 2 * cd * z
+			+ d2;
+		return r > 0.0 ? r : 0.0;
+	}
+};
+
+// Simplifies the triangles in indices (3 per triangle, into verts) towards
+// nTargetTriangles, writing the result to out. Vertices with bLocked set never
+// move, which keeps borders shared with other meshes intact. Returns the largest
+// error of any collapse made, as a distance in model units.
+//
+// The work is done on a local numbering of just the vertices indices uses, so
+// simplifying a small piece of a large mesh costs nothing per vertex of the
+// rest of it. The numbering keeps the original order, so the result is the same
+// as it would be on the original indices.
+float SimplifyTriangles(const vertexArrays& verts, const std::vector<uint32_t>& indices, const std::vector<uint8_t>& bLocked,
+	size_t nTargetTriangles, std::vector<uint32_t>& out)
+{
+	std::vector<uint32_t> vecGlobal(indices);
+	std::sort(vecGlobal.begin(), vecGlobal.end());
+	vecGlobal.erase(std::unique(vecGlobal.begin(), vecGlobal.end()), vecGlobal.end());
+
+	out.resize(indices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+		out[i] = (uint32_t)(std::lower_bound(vecGlobal.begin(), vecGlobal.end(), indices[i]) - vecGlobal.begin());
+
+	size_t nVerts = vecGlobal.size();
+	float fMaxError = 0.0f;
+
+	// Every vertex starts with the planes of the triangles around it
+	std::vector<quadric> vecQuadrics(nVerts);
+	for (size_t i = 0; i < out.size(); i += 3)
+	{
+		vec3d p0 = verts.Get(vecGlobal[out[i]]), p1 = verts.Get(vecGlobal[out[i + 1]]), p2 = verts.Get(vecGlobal[out[i + 2]]);
+		double ux = p1.x - p0.x, uy = p1.y - p0.y, uz = p1.z - p0.z;
+		double vx = p2.x - p0.x, vy = p2.y - p0.y, vz = p2.z - p0.z;
+		double nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+		double l = sqrt(nx * nx + ny * ny + nz * nz);
+		if (l <= 0.0)
+			continue;
+		nx /= l; ny /= l; nz /= l;
+		double d = -(nx * p0.x + ny * p0.y + nz * p0.z);
+		for (int k = 0; k < 3; k++)
+			vecQuadrics[out[i + k]].AddPlane(nx, ny, nz, d);
+	}
+
+	struct collapse
+	{
+		double dCost;
+		uint32_t nFrom, nTo;
+		bool operator<(const collapse& c) const
+		{
+			return dCost < c.dCost || (dCost == c.dCost && (nFrom < c.nFrom || (nFrom == c.nFrom && nTo < c.nTo)));
+		}
+	};
+	std::vector<collapse> vecCollapses;
+	std::vector<std::vector<uint32_t>> vecVertexTriangles(nVerts);
+	std::vector<bool> bTouched(nVerts);
+
+	// Each pass collapses the cheapest edges, at most one per vertex, then
+	// everything is re-evaluated on the result
+	while (out.size() / 3 > nTargetTriangles)
+	{
+		for (auto& v : vecVertexTriangles)
+			v.clear();
+		for (uint32_t t = 0; t < out.size() / 3; t++)
+			for (int k = 0; k < 3; k++)
+				vecVertexTriangles[out[t * 3 + k]].push_back(t);
+
+		vecCollapses.clear();
+		for (size_t i = 0; i < out.size(); i++)
+		{
+			uint32_t a = out[i], b = out[i - i % 3 + (i + 1) % 3];
+			for (int nDir = 0; nDir < 2; nDir++)
+			{
+				uint32_t nFrom = nDir ? b : a, nTo = nDir ? a : b;
+				if (bLocked[vecGlobal[nFrom]])
+					continue;
+				quadric q = vecQuadrics[nFrom];
+				q.Add(vecQuadrics[nTo]);
+				vec3d p = verts.Get(vecGlobal[nTo]);
+				vecCollapses.push_back({ q.Evaluate(p.x, p.y, p.z), nFrom, nTo });
+			}
+		}
+		std::sort(vecCollapses.begin(), vecCollapses.end());
+
+		std::fill(bTouched.begin(), bTouched.end(), false);
+		size_t nTriangles = out.size() / 3;
+		std::vector<bool> bRemoved(nTriangles);
+		size_t nRemoved = 0;
+		bool bCollapsed = false;
+
+		for (auto& c : vecCollapses)
+		{
+			if (nTriangles - nRemoved <= nTargetTriangles)
+				break;
+			if (bTouched[c.nFrom] || bTouched[c.nTo])
+				continue;
+
+			// Refuse to fold a triangle over: moving nFrom to nTo must not turn any
+			// surviving triangle around it by more than about 80 degrees
+			vec3d pTo = verts.Get(vecGlobal[c.nTo]);
+			bool bFlips = false;
+			for (uint32_t t : vecVertexTriangles[c.nFrom])
+			{
+				uint32_t* tri = &out[t * 3];
+				if (bRemoved[t] || tri[0] == c.nTo || tri[1] == c.nTo || tri[2] == c.nTo)
+					continue;
+
+				vec3d p[3], q[3];
+				for (int k = 0; k < 3; k++)
+				{
+					p[k] = verts.Get(vecGlobal[tri[k]]);
+					q[k] = tri[k] == c.nFrom ? pTo : p[k];
+				}
+				vec3d u0 = p[1] - p[0], v0 = p[2] - p[0], u1 = q[1] - q[0], v1 = q[2] - q[0];
+				vec3d n0 = ComputeCrossProduct(u0, v0), n1 = ComputeCrossProduct(u1, v1);
+				float d = ComputeDotProduct(n0, n1);
+				if (d <= 0.17f * GetVectorLength(n0) * GetVectorLength(n1))
+				{
+					bFlips = true;
+					break;
+				}
+			}
+			if (bFlips)
+				continue;
+
+			// Triangles on the edge disappear, the rest of the fan moves to nTo
+			for (uint32_t t : vecVertexTriangles[c.nFrom])
+			{
+				uint32_t* tri = &out[t * 3];
+				if (bRemoved[t])
+					continue;
+				if (tri[0] == c.nTo || tri[1] == c.nTo || tri[2] == c.nTo)
+				{
+					bRemoved[t] = true;
+					nRemoved++;
+				}
+				else
+					for (int k = 0; k < 3; k++)
+						if (tri[k] == c.nFrom)
+							tri[k] = c.nTo;
+			}
+
+			vecQuadrics[c.nTo].Add(vecQuadrics[c.nFrom]);
+			bTouched[c.nFrom] = bTouched[c.nTo] = true;
+			fMaxError = std::max(fMaxError, (float)sqrt(c.dCost));
+			bCollapsed = true;
+		}
+
+		if (!bCollapsed)
+			break;
+
+		size_t nKept = 0;
+		for (size_t t = 0; t < nTriangles; t++)
+			if (!bRemoved[t])
+			{
+				for (int k = 0; k < 3; k++)
+					out[nKept * 3 + k] = out[t * 3 + k];
+				nKept++;
+			}
+		out.resize(nKept * 3);
+	}
+
+	for (uint32_t& i : out)
+		i = vecGlobal[i];
+	return fMaxError;
+}
+
+#endif
@@ -1,20 +1,31 @@
 #pragma once
-#pragma comment(lib, "winmm.lib")
 
-#ifndef UNICODE
-#error Please enable UNICODE for your compiler! VS: Project Properties -> General -> \
-Character Set -> Use Unicode. Thanks! - Javidx9
-#endif
-
-#include <windows.h>
+#include "consoleBackend.h"
+#include "edgeRasterizer.h"
+#include "framePresenter.h"
+#include "frameProfiler.h"
+#include "inputLog.h"
+#include "frameLimiter.h"
+#include "audioMixer.h"
 
 #include <iostream>
 #include <chrono>
 #include <vector>
-#include <list>
 #include <thread>
 #include <atomic>
 #include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <cstring>
+#include <cwchar>
+#include <cmath>
+#include <algorithm>
+
+// SSE2 is part of every x64 CPU; 32 bit builds only get it when asked for
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OLC_SPAN_SSE2
+#include <emmintrin.h>
+#endif
 
 enum COLOUR
 {
@@ -202,8 +213,11 @@ public:
 		m_nScreenWidth = 80;
 		m_nScreenHeight = 30;
 
-		m_hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-		m_hConsoleIn = GetStdHandle(STD_INPUT_HANDLE);
+#ifdef _WIN32
+		m_pBackend.reset(new olcWindowsConsoleBackend());
+#else
+		m_pBackend.reset(new olcHeadlessBackend());
+#endif
 
 		std::memset(m_keyNewState, 0, 256 * sizeof(short));
 		std::memset(m_keyOldState, 0, 256 * sizeof(short));
@@ -221,87 +235,118 @@ public:
 		m_bEnableSound = true;
 	}
 
-	int ConstructConsole(int width, int height, int fontw, int fonth)
+	// Present on a separate thread while the next frame is drawn, see
+	// olcFramePresenter. bPreserveFrame keeps the usual guarantee that the screen
+	// buffer still holds the previous frame; games that redraw every cell can turn
+	// it off and save a copy per frame. Must be called before Start.
+	void SetPipelinedPresent(bool bEnable, bool bDropStale = false, bool bPreserveFrame = true)
+	{
+		m_bPipelinedPresent = bEnable;
+		m_bDropStaleFrames = bDropStale;
+		m_bPreserveFrame = bPreserveFrame;
+	}
+
+	// Simulate in steps of exactly fStep seconds, decoupled from the frame rate:
+	// OnUserFixedUpdate runs as many times as the time since the last frame
+	// allows, then OnUserUpdate draws once, with GetInterpolation saying how far
+	// it is between the last step and the next. After nMaxSteps in one frame the
+	// rest of the time is dropped rather than falling further behind. 0 turns
+	// it off and OnUserUpdate alone sees the real frame times again.
+	void SetFixedTimestep(float fStep, int nMaxSteps = 8)
+	{
+		m_fFixedStep = fStep;
+		m_nMaxFixedSteps = nMaxSteps;
+		m_fAccumulator = 0.0f;
+		m_fInterpolation = 0.0f;
+	}
+
+	float GetFixedTimestep() const
+	{
+		return m_fFixedStep;
+	}
+
+	// Fraction of a fixed step simulated time has run past the last step, 0 to 1
+	float GetInterpolation() const
+	{
+		return m_fInterpolation;
+	}
+
+	// Sleep so no more than fFramesPerSecond frames are drawn, 0 for no limit
+	void SetFrameCap(float fFramesPerSecond)
+	{
+		m_fFrameCap = fFramesPerSecond;
+	}
+
+	// Write every frame's input and elapsed time to sFile, see inputLog.h. Must be
+	// called before Start.
+	void SetInputRecording(const std::string& sFile)
+	{
+		m_sInputRecordFile = sFile;
+	}
+
+	// Take input and elapsed times from a log written by SetInputRecording instead
+	// of the backend and the clock, and stop when it runs out, so the game sees
+	// exactly the session that was recorded. A fFixedStep above 0 replaces the
+	// recorded elapsed times. Must be called before Start.
+	void SetInputReplay(const std::string& sFile, float fFixedStep = 0.0f)
+	{
+		m_sInputReplayFile = sFile;
+		m_fReplayStep = fFixedStep;
+	}
+
+	// Why the log given to SetInputRecording or SetInputReplay could not be used,
+	// empty if nothing went wrong. The game does not start without its log.
+	const std::string& InputLogError() const
+	{
+		return m_sInputLogError;
+	}
+
+	// Per stage timings and counters, see frameProfiler. Games time their own
+	// stages with frameProfiler::scope; the engine times presenting and, with
+	// bOverlay, draws the recent history over the top of every frame.
+	void EnableProfiler(bool bEnable, bool bOverlay = false)
+	{
+		m_profiler.Enable(bEnable);
+		m_bProfilerOverlay = bEnable && bOverlay;
+	}
+
+	frameProfiler& Profiler()
+	{
+		return m_profiler;
+	}
+
+	// Cells some triangle has written depth to since the last ClearDepth
+	size_t CountCoveredCells() const
 	{
-		if (m_hConsole == INVALID_HANDLE_VALUE)
-			return Error(L"Bad Handle");
+		size_t nCells = (size_t)m_nScreenWidth * m_nScreenHeight, nCovered = 0;
+		for (size_t i = 0; i < nCells; i++)
+			nCovered += m_bufDepth[i] != 0.0f;
+		return nCovered;
+	}
 
+	// Replace the platform backend, must be called before ConstructConsole
+	void SetBackend(std::unique_ptr<olcConsoleBackend> backend)
+	{
+		m_pBackend = std::move(backend);
+	}
+
+	int ConstructConsole(int width, int height, int fontw, int fonth)
+	{
 		m_nScreenWidth = width;
 		m_nScreenHeight = height;
 
-		// Update 13/09/2017 - It seems that the console behaves differently on some systems
-		// and I'm unsure why this is. It could be to do with windows default settings, or
-		// screen resolutions, or system languages. Unfortunately, MSDN does not offer much
-		// by way of useful information, and so the resulting sequence is the reult of experiment
-		// that seems to work in multiple cases.
-		//
-		// The problem seems to be that the SetConsoleXXX functions are somewhat circular and 
-		// fail depending on the state of the current console properties, i.e. you can't set
-		// the buffer size until you set the screen size, but you can't change the screen size
-		// until the buffer size is correct. This coupled with a precise ordering of calls
-		// makes this procedure seem a little mystical :-P. Thanks to wowLinh for helping - Jx9
-
-		// Change console visual size to a minimum so ScreenBuffer can shrink
-		// below the actual visual size
-		m_rectWindow = { 0, 0, 1, 1 };
-		SetConsoleWindowInfo(m_hConsole, TRUE, &m_rectWindow);
-
-		// Set the size of the screen buffer
-		COORD coord = { (short)m_nScreenWidth, (short)m_nScreenHeight };
-		if (!SetConsoleScreenBufferSize(m_hConsole, coord))
-			Error(L"SetConsoleScreenBufferSize");
-
-		// Assign screen buffer to the console
-		if (!SetConsoleActiveScreenBuffer(m_hConsole))
-			return Error(L"SetConsoleActiveScreenBuffer");
-
-		// Set the font size now that the screen buffer has been assigned to the console
-		CONSOLE_FONT_INFOEX cfi;
-		cfi.cbSize = sizeof(cfi);
-		cfi.nFont = 0;
-		cfi.dwFontSize.X = fontw;
-		cfi.dwFontSize.Y = fonth;
-		cfi.FontFamily = FF_DONTCARE;
-		cfi.FontWeight = FW_NORMAL;
-
-		/*	DWORD version = GetVersion();
-			DWORD major = (DWORD)(LOBYTE(LOWORD(version)));
-			DWORD minor = (DWORD)(HIBYTE(LOWORD(version)));*/
-
-			//if ((major > 6) || ((major == 6) && (minor >= 2) && (minor < 4)))		
-			//	wcscpy_s(cfi.FaceName, L"Raster"); // Windows 8 :(
-			//else
-			//	wcscpy_s(cfi.FaceName, L"Lucida Console"); // Everything else :P
-
-			//wcscpy_s(cfi.FaceName, L"Liberation Mono");
-		wcscpy_s(cfi.FaceName, L"Consolas");
-		if (!SetCurrentConsoleFontEx(m_hConsole, false, &cfi))
-			return Error(L"SetCurrentConsoleFontEx");
-
-		// Get screen buffer info and check the maximum allowed window size. Return
-		// error if exceeded, so user knows their dimensions/fontsize are too large
-		CONSOLE_SCREEN_BUFFER_INFO csbi;
-		if (!GetConsoleScreenBufferInfo(m_hConsole, &csbi))
-			return Error(L"GetConsoleScreenBufferInfo");
-		if (m_nScreenHeight > csbi.dwMaximumWindowSize.Y)
-			return Error(L"Screen Height / Font Height Too Big");
-		if (m_nScreenWidth > csbi.dwMaximumWindowSize.X)
-			return Error(L"Screen Width / Font Width Too Big");
-
-		// Set Physical Console Window Size
-		m_rectWindow = { 0, 0, (short)m_nScreenWidth - 1, (short)m_nScreenHeight - 1 };
-		if (!SetConsoleWindowInfo(m_hConsole, TRUE, &m_rectWindow))
-			return Error(L"SetConsoleWindowInfo");
-
-		// Set flags to allow mouse input		
-		if (!SetConsoleMode(m_hConsoleIn, ENABLE_EXTENDED_FLAGS | ENABLE_WINDOW_INPUT | ENABLE_MOUSE_INPUT))
-			return Error(L"SetConsoleMode");
+		if (!m_pBackend->Construct(width, height, fontw, fonth))
+			return 0;
 
 		// Allocate memory for screen buffer
 		m_bufScreen = new CHAR_INFO[m_nScreenWidth * m_nScreenHeight];
 		memset(m_bufScreen, 0, sizeof(CHAR_INFO) * m_nScreenWidth * m_nScreenHeight);
+		m_bufDepth = new float[m_nScreenWidth * m_nScreenHeight];
+		ClearDepth();
 
+#ifdef _WIN32
 		SetConsoleCtrlHandler((PHANDLER_ROUTINE)CloseHandler, TRUE);
+#endif
 		return 1;
 	}
 
@@ -338,6 +383,9 @@ public:
 		return c;
 	}
 
+	// Fill, FillCircle and the triangle fills write whole spans straight into the
+	// screen buffer rather than calling this per cell. An override that has to see
+	// every cell they draw should call SetDirectSpans(false).
 	virtual void Draw(int x, int y, short c = 0x2588, short col = 0x000F)
 	{
 		if (x >= 0 && x < m_nScreenWidth && y >= 0 && y < m_nScreenHeight)
@@ -347,13 +395,41 @@ public:
 		}
 	}
 
+	// Cells x1 to x2 inclusive of row y, clipped to the screen once for the lot
+	void DrawSpan(int x1, int x2, int y, short c = 0x2588, short col = 0x000F)
+	{
+		if (y < 0 || y >= m_nScreenHeight)
+			return;
+		if (x1 < 0) x1 = 0;
+		if (x2 >= m_nScreenWidth) x2 = m_nScreenWidth - 1;
+		if (x1 > x2)
+			return;
+
+		if (!m_bDirectSpans)
+		{
+			for (int x = x1; x <= x2; x++)
+				Draw(x, y, c, col);
+			return;
+		}
+
+		CHAR_INFO ci;
+		ci.Char.UnicodeChar = c;
+		ci.Attributes = col;
+		FillCells(m_bufScreen + y * m_nScreenWidth + x1, x2 - x1 + 1, ci);
+	}
+
+	// false sends every cell of the span based fills through Draw, for overrides of it
+	void SetDirectSpans(bool bDirect)
+	{
+		m_bDirectSpans = bDirect;
+	}
+
 	void Fill(int x1, int y1, int x2, int y2, short c = 0x2588, short col = 0x000F)
 	{
 		Clip(x1, y1);
 		Clip(x2, y2);
-		for (int x = x1; x < x2; x++)
-			for (int y = y1; y < y2; y++)
-				Draw(x, y, c, col);
+		for (int y = y1; y < y2; y++)
+			DrawSpan(x1, x2 - 1, y, c, col);
 	}
 
 	void DrawString(int x, int y, std::wstring c, short col = 0x000F)
@@ -365,6 +441,63 @@ public:
 		}
 	}
 
+	// Average stage times and counters over the profiler's history, above a
+	// stacked bar per frame, oldest on the left, scaled to the slowest frame
+	void DrawProfilerOverlay(int x, int y)
+	{
+		static const short nStageColours[STAGE_COUNT] = { FG_CYAN, FG_BLUE, FG_GREEN, FG_MAGENTA, FG_GREY, FG_RED, FG_YELLOW };
+		const int nGraphHeight = 40;
+
+		size_t nFrames = m_profiler.HistorySize();
+		if (nFrames == 0)
+			return;
+		frameStats avg = m_profiler.Average();
+		double dWorst = 0.0;
+		for (size_t i = 0; i < nFrames; i++)
+			dWorst = std::max(dWorst, m_profiler.History(i).dFrameTime);
+
+		int nGraphWidth = std::min((int)nFrames, m_nScreenWidth - x);
+		int nTextRows = STAGE_COUNT + 2;
+		Fill(x, y, x + std::max(nGraphWidth, 48), y + nTextRows + nGraphHeight, PIXEL_SOLID, FG_BLACK);
+
+		wchar_t s[128];
+		swprintf(s, 128, L"frame %7.3f ms %6.0f fps worst %7.3f ms", 1000.0 * avg.dFrameTime, avg.dFrameTime > 0.0 ? 1.0 / avg.dFrameTime : 0.0, 1000.0 * dWorst);
+		DrawString(x, y, s, FG_WHITE);
+		for (int i = 0; i < STAGE_COUNT; i++)
+		{
+			const char* sName = ProfileStageName(i);
+			swprintf(s, 128, L"%-10ls %7.3f ms", std::wstring(sName, sName + strlen(sName)).c_str(), 1000.0 * avg.dStageTime[i]);
+			DrawString(x, y + 1 + i, s, nStageColours[i]);
+		}
+		swprintf(s, 128, L"clusters %llu verts %llu tris %llu raster %llu cells %llu",
+			(unsigned long long)avg.nCounters[COUNTER_CLUSTERS], (unsigned long long)avg.nCounters[COUNTER_VERTICES], (unsigned long long)avg.nCounters[COUNTER_TRIANGLES],
+			(unsigned long long)avg.nCounters[COUNTER_RASTER], (unsigned long long)avg.nCounters[COUNTER_CELLS]);
+		if (x + (int)wcslen(s) <= m_nScreenWidth)
+			DrawString(x, y + 1 + STAGE_COUNT, s, FG_WHITE);
+
+		// Time not spent in any stage is left dark grey
+		if (dWorst <= 0.0)
+			return;
+		int nBase = y + nTextRows + nGraphHeight - 1;
+		double dRowsPerSecond = nGraphHeight / dWorst;
+		for (int i = 0; i < nGraphWidth; i++)
+		{
+			const frameStats& f = m_profiler.History(nGraphWidth - 1 - i);
+			int nTop = nBase - (int)(f.dFrameTime * dRowsPerSecond);
+			double dStacked = 0.0;
+			for (int j = nBase; j > nTop; j--)
+				Draw(x + i, j, PIXEL_SOLID, FG_DARK_GREY);
+			for (int k = 0; k < STAGE_COUNT; k++)
+			{
+				int nFrom = nBase - (int)(dStacked * dRowsPerSecond);
+				dStacked += f.dStageTime[k];
+				int nTo = nBase - (int)(dStacked * dRowsPerSecond);
+				for (int j = nFrom; j > nTo; j--)
+					Draw(x + i, j, PIXEL_SOLID, nStageColours[k]);
+			}
+		}
+	}
+
 	void DrawStringAlpha(int x, int y, std::wstring c, short col = 0x000F)
 	{
 		for (size_t i = 0; i < c.size(); i++)
@@ -452,11 +585,196 @@ public:
 		DrawLine(x3, y3, x1, y1, c, col);
 	}
 
-	// https://www.avrfreaks.net/sites/default/files/triangles.c
+	// Spans are clipped to the screen once each, so triangles hanging off the
+	// edges can be drawn without clipping them first
 	void FillTriangle(int x1, int y1, int x2, int y2, int x3, int y3, short c = 0x2588, short col = 0x000F)
+	{
+		RasterizeTriangle(x1, y1, x2, y2, x3, y3, [&](int sx, int ex, int ny)
+		{
+			DrawSpan(sx, ex, ny, c, col);
+		});
+	}
+
+	// Same coverage as FillTriangle, but each cell is depth tested. z1..z3 must be
+	// 1/w of the projected vertices: unlike z itself that is linear in screen space,
+	// so a plane through the three vertices gives the perspective correct value at
+	// every cell. Larger values are closer to the camera.
+	void FillTriangleDepth(float x1, float y1, float z1, float x2, float y2, float z2, float x3, float y3, float z3, short c = 0x2588, short col = 0x000F)
+	{
+		FillTriangleDepthScissored(x1, y1, z1, x2, y2, z2, x3, y3, z3, c, col, 0, 0, m_nScreenWidth, m_nScreenHeight);
+	}
+
+	// FillTriangleDepth limited to the cells in [sx1, sx2) x [sy1, sy2). Depth is
+	// evaluated per cell rather than accumulated along the span, so a cell gets
+	// exactly the same value however the triangle was cut up, and triangles drawn
+	// into disjoint rectangles from several threads give the same picture
+	void FillTriangleDepthScissored(float x1, float y1, float z1, float x2, float y2, float z2, float x3, float y3, float z3,
+		short c, short col, int sx1, int sy1, int sx2, int sy2)
+	{
+		if (sx1 < 0) sx1 = 0;
+		if (sy1 < 0) sy1 = 0;
+		if (sx2 > m_nScreenWidth) sx2 = m_nScreenWidth;
+		if (sy2 > m_nScreenHeight) sy2 = m_nScreenHeight;
+
+		depthPlane plane(x1, y1, z1, x2, y2, z2, x3, y3, z3);
+		float A = plane.A, B = plane.B, C = plane.C;
+
+		CHAR_INFO ci;
+		ci.Char.UnicodeChar = c;
+		ci.Attributes = col;
+
+		// Floor rather than truncate, so a vertex overhanging the top or left edge in
+		// the guard band lands in the same cell as it would after clipping
+		RasterizeTriangle((int)floorf(x1), (int)floorf(y1), (int)floorf(x2), (int)floorf(y2), (int)floorf(x3), (int)floorf(y3), [&](int sx, int ex, int ny)
+		{
+			if (ny < sy1 || ny >= sy2)
+				return;
+			if (sx < sx1) sx = sx1;
+			if (ex >= sx2) ex = sx2 - 1;
+
+			float zRow = B * ((float)ny + 0.5f) + C;
+			float* rowDepth = m_bufDepth + ny * m_nScreenWidth;
+			CHAR_INFO* rowScreen = m_bufScreen + ny * m_nScreenWidth;
+			for (int i = sx; i <= ex; i++)
+			{
+				float z = A * ((float)i + 0.5f) + zRow;
+				if (z > rowDepth[i])
+				{
+					rowDepth[i] = z;
+					if (m_bDirectSpans)
+						rowScreen[i] = ci;
+					else
+						Draw(i, ny, c, col);
+				}
+			}
+		});
+	}
+
+	// Writes ci to n consecutive cells. A cell is a 4 byte glyph and attribute pair,
+	// so four go out with every 16 byte store.
+	static void FillCells(CHAR_INFO* p, size_t n, CHAR_INFO ci)
+	{
+		static_assert(sizeof(CHAR_INFO) == 4, "cells are stored as one 32 bit pattern");
+		size_t i = 0;
+#ifdef OLC_SPAN_SSE2
+		uint32_t nPattern;
+		memcpy(&nPattern, &ci, 4);
+		__m128i vPattern = _mm_set1_epi32((int)nPattern);
+		for (; i + 4 <= n; i += 4)
+			_mm_storeu_si128((__m128i*)(p + i), vPattern);
+#endif
+		for (; i < n; i++)
+			p[i] = ci;
+	}
+
+	// Depth tested fill with edge functions instead of scanlines: a cell is drawn
+	// when its centre is inside the triangle, with the top-left rule deciding
+	// centres exactly on an edge, so triangles sharing an edge neither overlap nor
+	// leave gaps. Takes the unrounded screen positions, z1..z3 are 1/w as for
+	// FillTriangleDepth, and only cells in [sx1, sx2) x [sy1, sy2) are touched.
+	void FillTriangleDepthEdgeScissored(float x1, float y1, float z1, float x2, float y2, float z2, float x3, float y3, float z3,
+		short c, short col, int sx1, int sy1, int sx2, int sy2)
+	{
+		if (sx1 < 0) sx1 = 0;
+		if (sy1 < 0) sy1 = 0;
+		if (sx2 > m_nScreenWidth) sx2 = m_nScreenWidth;
+		if (sy2 > m_nScreenHeight) sy2 = m_nScreenHeight;
+
+		if (!m_bDirectSpans)
+		{
+			RasterizeEdgeTriangleScalar(x1, y1, z1, x2, y2, z2, x3, y3, z3, m_bufDepth, m_nScreenWidth, sx1, sy1, sx2, sy2, [&](int i, int j)
+			{
+				Draw(i, j, c, col);
+			});
+			return;
+		}
+
+		CHAR_INFO ci;
+		ci.Char.UnicodeChar = c;
+		ci.Attributes = col;
+		RasterizeEdgeTriangle(x1, y1, z1, x2, y2, z2, x3, y3, z3, ci, m_bufScreen, m_bufDepth, m_nScreenWidth, sx1, sy1, sx2, sy2);
+	}
+
+	void FillTriangleDepthEdge(float x1, float y1, float z1, float x2, float y2, float z2, float x3, float y3, float z3, short c = 0x2588, short col = 0x000F)
+	{
+		FillTriangleDepthEdgeScissored(x1, y1, z1, x2, y2, z2, x3, y3, z3, c, col, 0, 0, m_nScreenWidth, m_nScreenHeight);
+	}
+
+	// Sets every cell of the screen to glyph c in colour col
+	void Clear(short c = PIXEL_SOLID, short col = FG_BLACK)
+	{
+		if (!m_bDirectSpans)
+		{
+			Fill(0, 0, m_nScreenWidth, m_nScreenHeight, c, col);
+			return;
+		}
+
+		CHAR_INFO ci;
+		ci.Char.UnicodeChar = c;
+		ci.Attributes = col;
+		FillCells(m_bufScreen, (size_t)m_nScreenWidth * m_nScreenHeight, ci);
+	}
+
+	// Clear for frames drawn entirely with depth tested fills, run after them
+	// instead of before: only cells no triangle reached (depth still 0) are
+	// written, so a screen covered edge to edge costs a read of the depth buffer
+	// and nothing more. Cells drawn without depth must come after this.
+	// Returns how many cells had to be cleared.
+	size_t ClearUncovered(short c = PIXEL_SOLID, short col = FG_BLACK)
+	{
+		CHAR_INFO ci;
+		ci.Char.UnicodeChar = c;
+		ci.Attributes = col;
+
+		size_t nCells = (size_t)m_nScreenWidth * m_nScreenHeight, nCleared = 0, i = 0;
+#ifdef OLC_SPAN_SSE2
+		if (m_bDirectSpans)
+		{
+			uint32_t nPattern;
+			memcpy(&nPattern, &ci, 4);
+			__m128i vPattern = _mm_set1_epi32((int)nPattern);
+			__m128 vZero = _mm_setzero_ps();
+			for (; i + 4 <= nCells; i += 4)
+			{
+				__m128 vEmpty = _mm_cmpeq_ps(_mm_loadu_ps(m_bufDepth + i), vZero);
+				int nMask = _mm_movemask_ps(vEmpty);
+				if (nMask == 0)
+					continue;
+
+				__m128i vMask = _mm_castps_si128(vEmpty);
+				__m128i vOld = _mm_loadu_si128((const __m128i*)(m_bufScreen + i));
+				_mm_storeu_si128((__m128i*)(m_bufScreen + i), _mm_or_si128(_mm_and_si128(vMask, vPattern), _mm_andnot_si128(vMask, vOld)));
+				nCleared += (nMask & 1) + ((nMask >> 1) & 1) + ((nMask >> 2) & 1) + ((nMask >> 3) & 1);
+			}
+		}
+#endif
+		for (; i < nCells; i++)
+		{
+			if (m_bufDepth[i] == 0.0f)
+			{
+				if (m_bDirectSpans)
+					m_bufScreen[i] = ci;
+				else
+					Draw((int)(i % m_nScreenWidth), (int)(i / m_nScreenWidth), c, col);
+				nCleared++;
+			}
+		}
+		return nCleared;
+	}
+
+	// Reset every cell of the depth buffer to "infinitely far away"
+	void ClearDepth()
+	{
+		std::fill(m_bufDepth, m_bufDepth + m_nScreenWidth * m_nScreenHeight, 0.0f);
+	}
+
+	// Walks the triangle one scanline at a time, handing each horizontal span
+	// [sx, ex] on row ny to drawline
+	// https://www.avrfreaks.net/sites/default/files/triangles.c
+	template <typename SPAN>
+	void RasterizeTriangle(int x1, int y1, int x2, int y2, int x3, int y3, SPAN drawline)
 	{
 		auto SWAP = [](int& x, int& y) { int t = x; x = y; y = t; };
-		auto drawline = [&](int sx, int ex, int ny) { for (int i = sx; i <= ex; i++) Draw(i, ny, c, col); };
 
 		int t1x, t2x, y, minx, maxx, t1xp, t2xp;
 		bool changed1 = false;
@@ -620,19 +938,13 @@ public:
 		int p = 3 - 2 * r;
 		if (!r) return;
 
-		auto drawline = [&](int sx, int ex, int ny)
-		{
-			for (int i = sx; i <= ex; i++)
-				Draw(i, ny, c, col);
-		};
-
 		while (y >= x)
 		{
 			// Modified to draw scan-lines instead of edges
-			drawline(xc - x, xc + x, yc - y);
-			drawline(xc - y, xc + y, yc - x);
-			drawline(xc - x, xc + x, yc + y);
-			drawline(xc - y, xc + y, yc + x);
+			DrawSpan(xc - x, xc + x, yc - y, c, col);
+			DrawSpan(xc - y, xc + y, yc - x, c, col);
+			DrawSpan(xc - x, xc + x, yc + y, c, col);
+			DrawSpan(xc - y, xc + y, yc + x, c, col);
 			if (p < 0) p += 4 * x++ + 6;
 			else p += 4 * (x++ - y--) + 10;
 		}
@@ -710,8 +1022,8 @@ public:
 
 	~olcConsoleGameEngine()
 	{
-		SetConsoleActiveScreenBuffer(m_hOriginalConsole);
 		delete[] m_bufScreen;
+		delete[] m_bufDepth;
 	}
 
 public:
@@ -752,8 +1064,44 @@ private:
 			}
 		}
 
+		// With a presenter thread the game draws into its buffers in turn, and the
+		// engine's own buffer gets the last frame back at the end
+		std::unique_ptr<olcFramePresenter> pPresenter;
+		CHAR_INFO* bufScreenOwn = m_bufScreen;
+		if (m_bPipelinedPresent)
+		{
+			pPresenter.reset(new olcFramePresenter(*m_pBackend, m_nScreenWidth, m_nScreenHeight, m_bDropStaleFrames, m_bPreserveFrame));
+			m_bufScreen = pPresenter->Begin(m_bufScreen);
+		}
+
+		std::unique_ptr<inputLogWriter> pRecorder;
+		std::unique_ptr<inputLogReader> pReplay;
+		if (!m_sInputRecordFile.empty())
+		{
+			pRecorder.reset(new inputLogWriter());
+			if (!pRecorder->Open(m_sInputRecordFile))
+			{
+				m_sInputLogError = "Could not write input log " + m_sInputRecordFile;
+				m_bAtomActive = false;
+			}
+		}
+		if (!m_sInputReplayFile.empty())
+		{
+			pReplay.reset(new inputLogReader());
+			if (!pReplay->Open(m_sInputReplayFile))
+			{
+				m_sInputLogError = "Could not read input log " + m_sInputReplayFile + ", missing or not a log of this version";
+				m_bAtomActive = false;
+			}
+		}
+
+		frameLimiter limiter;
+		limiter.SetRate(m_fFrameCap);
+		m_timings.bPaced = m_fFixedStep > 0.0f || limiter.Enabled();
+
 		auto tp1 = std::chrono::system_clock::now();
 		auto tp2 = std::chrono::system_clock::now();
+		auto tpStart = tp1;
 
 		while (m_bAtomActive)
 		{
@@ -765,12 +1113,41 @@ private:
 				std::chrono::duration<float> elapsedTime = tp2 - tp1;
 				tp1 = tp2;
 				float fElapsedTime = elapsedTime.count();
+				m_profiler.BeginFrame();
 
 				// Handle Keyboard Input
-				for (int i = 0; i < 256; i++)
+				m_pBackend->PollInput(m_keyNewState, m_mouseNewState, m_mousePosX, m_mousePosY, m_bConsoleInFocus);
+
+				inputFrame input;
+				if (pReplay)
 				{
-					m_keyNewState[i] = GetAsyncKeyState(i);
+					if (!pReplay->Read(input))
+					{
+						// Done with, so a game that refuses to be destroyed goes on with live input
+						pReplay.reset();
+						m_bAtomActive = false;
+						break;
+					}
+					fElapsedTime = m_fReplayStep > 0.0f ? m_fReplayStep : input.fElapsedTime;
+					memcpy(m_keyNewState, input.nKeyStates, sizeof(m_keyNewState));
+					memcpy(m_mouseNewState, input.bMouseStates, sizeof(m_mouseNewState));
+					m_mousePosX = input.nMouseX;
+					m_mousePosY = input.nMouseY;
+					m_bConsoleInFocus = input.bFocused;
+				}
+				if (pRecorder)
+				{
+					input.fElapsedTime = fElapsedTime;
+					memcpy(input.nKeyStates, m_keyNewState, sizeof(m_keyNewState));
+					memcpy(input.bMouseStates, m_mouseNewState, sizeof(m_mouseNewState));
+					input.nMouseX = m_mousePosX;
+					input.nMouseY = m_mousePosY;
+					input.bFocused = m_bConsoleInFocus;
+					pRecorder->Write(input);
+				}
 
+				for (int i = 0; i < 256; i++)
+				{
 					m_keys[i].bPressed = false;
 					m_keys[i].bReleased = false;
 
@@ -791,56 +1168,6 @@ private:
 					m_keyOldState[i] = m_keyNewState[i];
 				}
 
-				// Handle Mouse Input - Check for window events
-				INPUT_RECORD inBuf[32];
-				DWORD events = 0;
-				GetNumberOfConsoleInputEvents(m_hConsoleIn, &events);
-				if (events > 0)
-					ReadConsoleInput(m_hConsoleIn, inBuf, events, &events);
-
-				// Handle events - we only care about mouse clicks and movement
-				// for now
-				for (DWORD i = 0; i < events; i++)
-				{
-					switch (inBuf[i].EventType)
-					{
-					case FOCUS_EVENT:
-					{
-						m_bConsoleInFocus = inBuf[i].Event.FocusEvent.bSetFocus;
-					}
-					break;
-
-					case MOUSE_EVENT:
-					{
-						switch (inBuf[i].Event.MouseEvent.dwEventFlags)
-						{
-						case MOUSE_MOVED:
-						{
-							m_mousePosX = inBuf[i].Event.MouseEvent.dwMousePosition.X;
-							m_mousePosY = inBuf[i].Event.MouseEvent.dwMousePosition.Y;
-						}
-						break;
-
-						case 0:
-						{
-							for (int m = 0; m < 5; m++)
-								m_mouseNewState[m] = (inBuf[i].Event.MouseEvent.dwButtonState & (1 << m)) > 0;
-
-						}
-						break;
-
-						default:
-							break;
-						}
-					}
-					break;
-
-					default:
-						break;
-						// We don't care just at the moment
-					}
-				}
-
 				for (int m = 0; m < 5; m++)
 				{
 					m_mouse[m].bPressed = false;
@@ -864,16 +1191,93 @@ private:
 				}
 
 
+				auto tpInput = std::chrono::system_clock::now();
+
+				// Fixed simulation steps, then one update to draw the frame
+				if (m_fFixedStep > 0.0f)
+				{
+					m_fAccumulator += fElapsedTime;
+					int nSteps = 0;
+					while (m_fAccumulator >= m_fFixedStep && m_bAtomActive)
+					{
+						if (nSteps == m_nMaxFixedSteps)
+						{
+							float fDropped = m_fAccumulator - fmodf(m_fAccumulator, m_fFixedStep);
+							m_timings.dDroppedTime += fDropped;
+							m_fAccumulator -= fDropped;
+							break;
+						}
+						if (!OnUserFixedUpdate(m_fFixedStep))
+							m_bAtomActive = false;
+						m_fAccumulator -= m_fFixedStep;
+						nSteps++;
+					}
+					m_fInterpolation = m_fAccumulator / m_fFixedStep;
+					m_timings.nTicks += nSteps;
+				}
+
 				// Handle Frame Update
-				if (!OnUserUpdate(fElapsedTime))
+				if (m_bAtomActive && !OnUserUpdate(fElapsedTime))
 					m_bAtomActive = false;
 
+				if (m_bProfilerOverlay)
+					DrawProfilerOverlay(0, 0);
+
+				auto tpUpdate = std::chrono::system_clock::now();
+
 				// Update Title & Present Screen Buffer
 				wchar_t s[256];
-				swprintf_s(s, 256, L"OneLoneCoder.com - Console Game Engine - %s - FPS: %3.2f", m_sAppName.c_str(), 1.0f / fElapsedTime);
-				SetConsoleTitle(s);
-				WriteConsoleOutput(m_hConsole, m_bufScreen, { (short)m_nScreenWidth, (short)m_nScreenHeight }, { 0,0 }, &m_rectWindow);
+				swprintf(s, 256, L"OneLoneCoder.com - Console Game Engine - %ls - FPS: %3.2f", m_sAppName.c_str(), 1.0f / fElapsedTime);
+				if (pPresenter)
+				{
+					frameProfiler::scope profile(m_profiler, STAGE_PRESENT);
+					CHAR_INFO* bufDrawn = m_bufScreen;
+					m_bufScreen = pPresenter->Submit(s);
+					if (!pPresenter->KeepRunning())
+					{
+						m_bufScreen = bufDrawn;
+						m_bAtomActive = false;
+					}
+				}
+				else
+				{
+					frameProfiler::scope profile(m_profiler, STAGE_PRESENT);
+					m_pBackend->SetTitle(s);
+					m_pBackend->Present(m_bufScreen, m_nScreenWidth, m_nScreenHeight);
+
+					if (!m_pBackend->KeepRunning())
+						m_bAtomActive = false;
+				}
+
+				auto tpPresent = std::chrono::system_clock::now();
+				m_profiler.EndFrame();
+				m_timings.nFrames++;
+				m_timings.dInputTime += std::chrono::duration<double>(tpInput - tp2).count();
+				m_timings.dUpdateTime += std::chrono::duration<double>(tpUpdate - tpInput).count();
+				m_timings.dPresentTime += std::chrono::duration<double>(tpPresent - tpUpdate).count();
+
+				if (m_timings.bPaced)
+				{
+					m_timings.dSleepTime += limiter.Wait();
+					if (m_timings.nFrames > 1)
+					{
+						double dInterval = elapsedTime.count();
+						m_timings.dIntervalSum += dInterval;
+						m_timings.dIntervalSqSum += dInterval * dInterval;
+						m_timings.dMaxInterval = std::max(m_timings.dMaxInterval, dInterval);
+					}
+				}
+			}
+
+			if (pPresenter)
+			{
+				pPresenter->Stop();
+				pPresenter->AddTimings(m_timings);
+				memcpy(bufScreenOwn, m_bufScreen, sizeof(CHAR_INFO) * m_nScreenWidth * m_nScreenHeight);
+				m_bufScreen = bufScreenOwn;
+				pPresenter.reset();
 			}
+			m_timings.dTotalTime = std::chrono::duration<double>(std::chrono::system_clock::now() - tpStart).count();
 
 			if (m_bEnableSound)
 			{
@@ -884,13 +1288,25 @@ private:
 			if (OnUserDestroy())
 			{
 				// User has permitted destroy, so exit and clean up
+				if (pRecorder && !pRecorder->Close() && m_sInputLogError.empty())
+					m_sInputLogError = "Could not write input log " + m_sInputRecordFile;
 				delete[] m_bufScreen;
-				SetConsoleActiveScreenBuffer(m_hOriginalConsole);
+				m_bufScreen = nullptr;
+				delete[] m_bufDepth;
+				m_bufDepth = nullptr;
+				m_pBackend->Shutdown(m_timings);
 				m_cvGameFinished.notify_one();
 			}
 			else
 			{
-				// User denied destroy for some reason, so continue running
+				// User denied destroy for some reason, so continue running. The log
+				// keeps recording and frames go through a new presenter as before.
+				if (m_bPipelinedPresent)
+				{
+					pPresenter.reset(new olcFramePresenter(*m_pBackend, m_nScreenWidth, m_nScreenHeight, m_bDropStaleFrames, m_bPreserveFrame));
+					m_bufScreen = pPresenter->Begin(m_bufScreen);
+				}
+				tp1 = std::chrono::system_clock::now();
 				m_bAtomActive = true;
 			}
 		}
@@ -901,6 +1317,9 @@ public:
 	virtual bool OnUserCreate() = 0;
 	virtual bool OnUserUpdate(float fElapsedTime) = 0;
 
+	// Optional, see SetFixedTimestep
+	virtual bool OnUserFixedUpdate(float /*fStep*/) { return true; }
+
 	// Optional for clean up 
 	virtual bool OnUserDestroy() { return true; }
 
@@ -946,15 +1365,15 @@ protected: // Audio Engine =====================================================
 			}
 
 			// Search for audio data chunk
-			long nChunksize = 0;
+			int32_t nChunksize = 0;
 			std::fread(&dump, sizeof(char), 4, f); // Read chunk header
-			std::fread(&nChunksize, sizeof(long), 1, f); // Read chunk size
+			std::fread(&nChunksize, sizeof(int32_t), 1, f); // Read chunk size
 			while (strncmp(dump, "data", 4) != 0)
 			{
 				// Not audio data, so just skip it
 				std::fseek(f, nChunksize, SEEK_CUR);
 				std::fread(&dump, sizeof(char), 4, f);
-				std::fread(&nChunksize, sizeof(long), 1, f);
+				std::fread(&nChunksize, sizeof(int32_t), 1, f);
 			}
 
 			// Finally got to data, so read it all in and convert to float samples
@@ -992,17 +1411,10 @@ protected: // Audio Engine =====================================================
 	// This vector holds all loaded sound samples in memory
 	std::vector<olcAudioSample> vecAudioSamples;
 
-	// This structure represents a sound that is currently playing. It only
-	// holds the sound ID and where this instance of it is up to for its
-	// current playback
-	struct sCurrentlyPlayingSample
-	{
-		int nAudioSampleID = 0;
-		long nSamplePosition = 0;
-		bool bFinished = false;
-		bool bLoop = false;
-	};
-	std::list<sCurrentlyPlayingSample> listActiveSamples;
+	// Plays the loaded samples, see audioMixer.h. The audio thread mixes into
+	// m_vecMixBlock, which is sized before that thread starts.
+	audioMixer m_mixer;
+	std::vector<float> m_vecMixBlock;
 
 	// Load a 16-bit WAVE file @ 44100Hz ONLY into memory. A sample ID
 	// number is returned if successful, otherwise -1
@@ -1012,7 +1424,7 @@ protected: // Audio Engine =====================================================
 			return -1;
 
 		olcAudioSample a(sWavFile);
-		if (a.bSampleValid)
+		if (a.bSampleValid && m_mixer.AddSample(a.fSample, a.nSamples, a.nChannels) != 0)
 		{
 			vecAudioSamples.push_back(a);
 			return vecAudioSamples.size();
@@ -1021,23 +1433,23 @@ protected: // Audio Engine =====================================================
 			return -1;
 	}
 
-	// Add sample 'id' to the mixers sounds to play list
-	void PlaySample(int id, bool bLoop = false)
+	// Start another voice playing sample 'id'. The mixer picks it up at the start
+	// of its next block
+	void PlaySample(int id, bool bLoop = false, float fVolume = 1.0f)
 	{
-		sCurrentlyPlayingSample a;
-		a.nAudioSampleID = id;
-		a.nSamplePosition = 0;
-		a.bFinished = false;
-		a.bLoop = bLoop;
-		listActiveSamples.push_back(a);
+		if (m_bEnableSound)
+			m_mixer.Play(id, bLoop, fVolume);
 	}
 
+	// Stop every voice playing sample 'id'
 	void StopSample(int id)
 	{
-
+		if (m_bEnableSound)
+			m_mixer.Stop(id);
 	}
 
 	// The audio system uses by default a specific wave format
+#ifdef _WIN32
 	bool CreateAudio(unsigned int nSampleRate = 44100, unsigned int nChannels = 1,
 		unsigned int nBlocks = 8, unsigned int nBlockSamples = 512)
 	{
@@ -1084,6 +1496,8 @@ protected: // Audio Engine =====================================================
 			m_pWaveHeaders[n].lpData = (LPSTR)(m_pBlockMemory + (n * m_nBlockSamples));
 		}
 
+		m_vecMixBlock.assign(m_nBlockSamples, 0.0f);
+
 		m_bAudioThreadActive = true;
 		m_AudioThread = std::thread(&olcConsoleGameEngine::AudioThread, this);
 
@@ -1092,6 +1506,21 @@ protected: // Audio Engine =====================================================
 		m_cvBlockNotZero.notify_one();
 		return true;
 	}
+#else
+	// No sound device is wired up outside of Windows yet. The game runs on in
+	// silence rather than failing to start.
+	bool CreateAudio(unsigned int /*nSampleRate*/ = 44100, unsigned int /*nChannels*/ = 1,
+		unsigned int /*nBlocks*/ = 8, unsigned int /*nBlockSamples*/ = 512)
+	{
+		static bool bReported = false;
+		if (!bReported)
+			fprintf(stderr, "No sound device on this platform, sound is disabled\n");
+		bReported = true;
+
+		m_bEnableSound = false;
+		return true;
+	}
+#endif
 
 	// Stop and clean up audio system
 	bool DestroyAudio()
@@ -1100,6 +1529,7 @@ protected: // Audio Engine =====================================================
 		return false;
 	}
 
+#ifdef _WIN32
 	// Handler for soundcard request for more data
 	void waveOutProc(HWAVEOUT hWaveOut, UINT uMsg, DWORD dwParam1, DWORD dwParam2)
 	{
@@ -1157,12 +1587,15 @@ protected: // Audio Engine =====================================================
 					return fmax(fSample, -fMax);
 			};
 
+			// Every playing sample at once, then the user's sound per sample
+			m_mixer.Mix(m_vecMixBlock.data(), m_nBlockSamples / m_nChannels, m_nChannels);
+
 			for (unsigned int n = 0; n < m_nBlockSamples; n += m_nChannels)
 			{
 				// User Process
 				for (unsigned int c = 0; c < m_nChannels; c++)
 				{
-					nNewSample = (short)(clip(GetMixerOutput(c, m_fGlobalTime, fTimeStep), 1.0) * fMaxSample);
+					nNewSample = (short)(clip(GetMixerOutput(c, m_fGlobalTime, fTimeStep, m_vecMixBlock[n + c]), 1.0) * fMaxSample);
 					m_pBlockMemory[nCurrentBlock + n + c] = nNewSample;
 					nPreviousSample = nNewSample;
 				}
@@ -1177,27 +1610,26 @@ protected: // Audio Engine =====================================================
 			m_nBlockCurrent %= m_nBlockCount;
 		}
 	}
+#endif
 
 	// Overridden by user if they want to generate sound in real-time
-	virtual float onUserSoundSample(int nChannel, float fGlobalTime, float fTimeStep)
+	virtual float onUserSoundSample(int /*nChannel*/, float /*fGlobalTime*/, float /*fTimeStep*/)
 	{
 		return 0.0f;
 	}
 
 	// Overriden by user if they want to manipulate the sound before it is played
-	virtual float onUserSoundFilter(int nChannel, float fGlobalTime, float fSample)
+	virtual float onUserSoundFilter(int /*nChannel*/, float /*fGlobalTime*/, float fSample)
 	{
 		return fSample;
 	}
 
 	// The Sound Mixer - If the user wants to play many sounds simultaneously, and
 	// perhaps the same sound overlapping itself, then you need a mixer, which
-	// takes input from all sound sources for that audio frame. This mixer maintains
-	// a list of sound locations for all concurrently playing audio samples. Instead
-	// of duplicating audio data, we simply store the fact that a sound sample is in
-	// use and an offset into its sample data. As time progresses we update this offset
-	// until it is beyound the length of the sound sample it is attached to. At this
-	// point we remove the playing souind from the list.
+	// takes input from all sound sources for that audio frame. Instead of
+	// duplicating audio data, m_mixer keeps a voice per playing sound holding the
+	// sample it plays and an offset into its data, and adds them all up a block at
+	// a time before this is called for each sample of the block.
 	//
 	// Additionally, the users application may want to generate sound instead of just
 	// playing audio clips (think a synthesizer for example) in whcih case we also
@@ -1207,26 +1639,8 @@ protected: // Audio Engine =====================================================
 	// Finally, before the sound is issued to the operating system for performing, the
 	// user gets one final chance to "filter" the sound, perhaps changing the volume
 	// or adding funky effects
-	float GetMixerOutput(int nChannel, float fGlobalTime, float fTimeStep)
+	float GetMixerOutput(int nChannel, float fGlobalTime, float fTimeStep, float fMixerSample)
 	{
-		// Accumulate sample for this channel
-		float fMixerSample = 0.0f;
-
-		for (auto& s : listActiveSamples)
-		{
-			// Calculate sample position
-			s.nSamplePosition += (long)((float)vecAudioSamples[s.nAudioSampleID - 1].wavHeader.nSamplesPerSec * fTimeStep);
-
-			// If sample position is valid add to the mix
-			if (s.nSamplePosition < vecAudioSamples[s.nAudioSampleID - 1].nSamples)
-				fMixerSample += vecAudioSamples[s.nAudioSampleID - 1].fSample[(s.nSamplePosition * vecAudioSamples[s.nAudioSampleID - 1].nChannels) + nChannel];
-			else
-				s.bFinished = true; // Else sound has completed
-		}
-
-		// If sounds have completed then remove them
-		listActiveSamples.remove_if([](const sCurrentlyPlayingSample& s) {return s.bFinished; });
-
 		// The users application might be generating sound, so grab that if it exists
 		fMixerSample += onUserSoundSample(nChannel, fGlobalTime, fTimeStep);
 
@@ -1241,15 +1655,17 @@ protected: // Audio Engine =====================================================
 	unsigned int m_nBlockCurrent;
 
 	short* m_pBlockMemory = nullptr;
+#ifdef _WIN32
 	WAVEHDR* m_pWaveHeaders = nullptr;
 	HWAVEOUT m_hwDevice = nullptr;
+#endif
 
 	std::thread m_AudioThread;
-	std::atomic<bool> m_bAudioThreadActive = false;
-	std::atomic<unsigned int> m_nBlockFree = 0;
+	std::atomic<bool> m_bAudioThreadActive{ false };
+	std::atomic<unsigned int> m_nBlockFree{ 0 };
 	std::condition_variable m_cvBlockNotZero;
 	std::mutex m_muxBlockNotZero;
-	std::atomic<float> m_fGlobalTime = 0.0f;
+	std::atomic<float> m_fGlobalTime{ 0.0f };
 
 
 
@@ -1272,18 +1688,11 @@ public:
 	int GetMouseY() { return m_mousePosY; }
 	sKeyState GetMouse(int nMouseButtonID) { return m_mouse[nMouseButtonID]; }
 	bool IsFocused() { return m_bConsoleInFocus; }
+	const olcFrameTimings& GetFrameTimings() { return m_timings; }
 
 
 protected:
-	int Error(const wchar_t* msg)
-	{
-		wchar_t buf[256];
-		FormatMessage(FORMAT_MESSAGE_FROM_SYSTEM, NULL, GetLastError(), MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), buf, 256, NULL);
-		SetConsoleActiveScreenBuffer(m_hOriginalConsole);
-		wprintf(L"ERROR: %s\n\t%s\n", msg, buf);
-		return 0;
-	}
-
+#ifdef _WIN32
 	static BOOL CloseHandler(DWORD evt)
 	{
 		// Note this gets called in a seperate OS thread, so it must
@@ -1299,23 +1708,37 @@ protected:
 		}
 		return true;
 	}
+#endif
 
 protected:
 	int m_nScreenWidth;
 	int m_nScreenHeight;
-	CHAR_INFO* m_bufScreen;
+	CHAR_INFO* m_bufScreen = nullptr;
+	float* m_bufDepth = nullptr;
 	std::wstring m_sAppName;
-	HANDLE m_hOriginalConsole;
-	CONSOLE_SCREEN_BUFFER_INFO m_OriginalConsoleInfo;
-	HANDLE m_hConsole;
-	HANDLE m_hConsoleIn;
-	SMALL_RECT m_rectWindow;
+	std::unique_ptr<olcConsoleBackend> m_pBackend;
+	olcFrameTimings m_timings;
 	short m_keyOldState[256] = { 0 };
 	short m_keyNewState[256] = { 0 };
 	bool m_mouseOldState[5] = { 0 };
 	bool m_mouseNewState[5] = { 0 };
 	bool m_bConsoleInFocus = true;
 	bool m_bEnableSound = false;
+	bool m_bDirectSpans = true;
+	bool m_bPipelinedPresent = false;
+	bool m_bDropStaleFrames = false;
+	bool m_bPreserveFrame = true;
+	frameProfiler m_profiler;
+	std::string m_sInputRecordFile;
+	std::string m_sInputReplayFile;
+	float m_fReplayStep = 0.0f;
+	std::string m_sInputLogError;
+	float m_fFixedStep = 0.0f;
+	int m_nMaxFixedSteps = 8;
+	float m_fAccumulator = 0.0f;
+	float m_fInterpolation = 0.0f;
+	float m_fFrameCap = 0.0f;
+	bool m_bProfilerOverlay = false;
 
 	// These need to be static because of the OnDestroy call the OS may make. The OS
 	// spawns a special thread just for that
@@ -0,0 +1,203 @@
+#pragma once
+
+#ifndef PARALLEL_OBJ_LOADER_H
+#define PARALLEL_OBJ_LOADER_H
+
+#include "utils.h"
+#include "workerPool.h"
+
+#include <algorithm>
+
+// Multithreaded .obj loading for files too large to parse on one core. The
+// mapped file is cut into chunks at line boundaries and every chunk is parsed on
+// its own into local arrays. A chunk cannot know how many vertices came before it,
+// so face corners are kept as written and resolved once the per-chunk vertex
+// counts have been summed. The result is the same mesh LoadFromObjFile builds.
+
+// Files smaller than this are not worth splitting
+const size_t nObjMinChunkBytes = 1 << 20;
+
+struct objChunk
+{
+	const char* pBegin = nullptr;
+	const char* pEnd = nullptr;
+
+	vertexArrays verts;
+	std::vector<int64_t> vecCorners; // Indices as written in the file, 1 based or negative
+	std::vector<uint32_t> vecFaceCorners; // Corners of each face
+	std::vector<uint32_t> vecFaceVertices; // Vertices this chunk had read when the face came up
+
+	size_t nFirstVertex = 0; // Filled in by the prefix sum
+	std::vector<uint32_t> indices;
+	size_t nFirstIndex = 0;
+	size_t nFaces = 0;
+	size_t nSkippedFaces = 0;
+	size_t nTriangles = 0;
+
+	// First pass, needs nothing from the other chunks
+	void Parse()
+	{
+		const char* p = pBegin;
+		while (p < pEnd)
+		{
+			while (p < pEnd && (*p == ' ' || *p == '\t'))
+				p++;
+
+			const char* pLineEnd = (const char*)memchr(p, '\n', pEnd - p);
+			if (pLineEnd == nullptr)
+				pLineEnd = pEnd;
+
+			if (pLineEnd - p >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+			{
+				float x = 0.0f, y = 0.0f, z = 0.0f;
+				const char* q = ParseObjFloat(p + 2, pLineEnd, x);
+				if (q) q = ParseObjFloat(q, pLineEnd, y);
+				if (q) q = ParseObjFloat(q, pLineEnd, z);
+				verts.push_back(x, y, z);
+			}
+			else if (pLineEnd - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+			{
+				uint32_t nCorners = 0;
+				const char* q = p + 2;
+				int64_t n;
+				while ((q = ParseObjInt(q, pLineEnd, n)) != nullptr)
+				{
+					vecCorners.push_back(n);
+					nCorners++;
+					while (q < pLineEnd && *q != ' ' && *q != '\t' && *q != '\r')
+						q++;
+				}
+				vecFaceCorners.push_back(nCorners);
+				vecFaceVertices.push_back((uint32_t)verts.size());
+			}
+
+			p = pLineEnd + 1;
+		}
+	}
+
+	// Second pass, once nFirstVertex is known. Same rules as indexedMesh::ParseObj,
+	// where nMeshFirstVertex is what the mesh held before this file.
+	void Resolve(size_t nMeshFirstVertex)
+	{
+		std::vector<uint32_t> vecPolygon;
+		nFaces = vecFaceCorners.size();
+		size_t c = 0;
+		for (size_t f = 0; f < vecFaceCorners.size(); f++)
+		{
+			vecPolygon.clear();
+			bool bValid = true;
+			int64_t nVertexCount = (int64_t)(nFirstVertex + vecFaceVertices[f]);
+
+			for (uint32_t k = 0; k < vecFaceCorners[f]; k++)
+			{
+				int64_t n = vecCorners[c++];
+				int64_t nIndex = n > 0 ? n - 1 : nVertexCount + n;
+				if (n == 0 || nIndex < 0 || nIndex >= nVertexCount)
+					bValid = false;
+				vecPolygon.push_back((uint32_t)(nMeshFirstVertex + nIndex));
+			}
+
+			if (!bValid || vecPolygon.size() < 3)
+				nSkippedFaces++;
+			else
+			{
+				for (size_t k = 1; k + 1 < vecPolygon.size(); k++)
+				{
+					indices.push_back(vecPolygon[0]);
+					indices.push_back(vecPolygon[k]);
+					indices.push_back(vecPolygon[k + 1]);
+					nTriangles++;
+				}
+			}
+		}
+
+		// Nothing below is needed any more
+		std::vector<int64_t>().swap(vecCorners);
+		std::vector<uint32_t>().swap(vecFaceCorners);
+		std::vector<uint32_t>().swap(vecFaceVertices);
+	}
+};
+
+// Appends the .obj file to m like m.LoadFromObjFile, using every thread of the pool.
+// Chunks are at least nMinChunkBytes; a file too small for two of them, or a pool
+// of one thread, is read by LoadFromObjFile and reports a single chunk.
+bool LoadObjFileParallel(indexedMesh& m, const std::string& sFilename, workerPool& pool, objLoadStats* pStats = nullptr,
+	size_t nMinChunkBytes = nObjMinChunkBytes)
+{
+	auto tpStart = std::chrono::steady_clock::now();
+
+	mappedFile file;
+	if (!file.Open(sFilename))
+		return false;
+
+	// A few chunks per thread even out lines of different lengths
+	size_t nChunks = std::min(file.Size() / std::max<size_t>(nMinChunkBytes, 1), (size_t)pool.ThreadCount() * 4);
+	if (nChunks <= 1 || pool.ThreadCount() == 1)
+		return m.LoadFromObjFile(sFilename, pStats);
+
+	// Cut after the first newline past each even split, so no line is shared
+	const char* pData = file.Data();
+	const char* pEnd = pData + file.Size();
+	std::vector<objChunk> vecChunks(nChunks);
+	const char* p = pData;
+	for (size_t i = 0; i < nChunks; i++)
+	{
+		vecChunks[i].pBegin = p;
+		if (i + 1 < nChunks)
+		{
+			const char* pSplit = std::max(p, pData + file.Size() / nChunks * (i + 1));
+			const char* pNewline = (const char*)memchr(pSplit, '\n', pEnd - pSplit);
+			p = pNewline ? pNewline + 1 : pEnd;
+		}
+		else
+			p = pEnd;
+		vecChunks[i].pEnd = p;
+	}
+
+	pool.ParallelFor(nChunks, [&](size_t i) { vecChunks[i].Parse(); });
+
+	size_t nMeshFirstVertex = m.verts.size();
+	size_t nVertices = 0;
+	for (auto& chunk : vecChunks)
+	{
+		chunk.nFirstVertex = nVertices;
+		nVertices += chunk.verts.size();
+	}
+
+	pool.ParallelFor(nChunks, [&](size_t i) { vecChunks[i].Resolve(nMeshFirstVertex); });
+
+	objLoadStats stats;
+	stats.nBytes = file.Size();
+	stats.nVertices = nVertices;
+	stats.nChunks = nChunks;
+	size_t nMeshFirstIndex = m.indices.size();
+	size_t nIndices = 0;
+	for (auto& chunk : vecChunks)
+	{
+		chunk.nFirstIndex = nIndices;
+		nIndices += chunk.indices.size();
+		stats.nFaces += chunk.nFaces;
+		stats.nTriangles += chunk.nTriangles;
+		stats.nSkippedFaces += chunk.nSkippedFaces;
+	}
+
+	// Every chunk copies its own part into place
+	m.verts.resize(nMeshFirstVertex + nVertices);
+	m.indices.resize(nMeshFirstIndex + nIndices);
+	pool.ParallelFor(nChunks, [&](size_t i)
+	{
+		objChunk& chunk = vecChunks[i];
+		size_t v = nMeshFirstVertex + chunk.nFirstVertex;
+		std::copy(chunk.verts.x.begin(), chunk.verts.x.end(), m.verts.x.begin() + v);
+		std::copy(chunk.verts.y.begin(), chunk.verts.y.end(), m.verts.y.begin() + v);
+		std::copy(chunk.verts.z.begin(), chunk.verts.z.end(), m.verts.z.begin() + v);
+		std::copy(chunk.indices.begin(), chunk.indices.end(), m.indices.begin() + nMeshFirstIndex + chunk.nFirstIndex);
+	});
+
+	stats.dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tpStart).count();
+	if (pStats)
+		*pStats = stats;
+	return true;
+}
+
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+
+#ifndef TILE_RASTERIZER_H
+#define TILE_RASTERIZER_H
+
+#include "oldConsoleGameEngine.h"
+#include "utils.h"
+#include "workerPool.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+// Parallel raster stage. Screen space triangles are binned into fixed size tiles
+// by their bounding box, then every tile is rasterized by one worker, scissored to
+// its own cells. Tiles never share cells, and each tile draws its triangles in
+// submission order, so the result is identical to drawing them all on one thread.
+class tileRasterizer
+{
+public:
+	// Runs on the given pool; a pool of one thread skips binning altogether
+	tileRasterizer(workerPool& pool, int nTileWidth = 32, int nTileHeight = 32) : m_pool(pool)
+	{
+		m_nTileWidth = nTileWidth;
+		m_nTileHeight = nTileHeight;
+	}
+
+	// Scanline fills by default, edge function fills with bEdgeFunctions set
+	void SetEdgeFunctions(bool bEdgeFunctions)
+	{
+		m_bEdgeFunctions = bEdgeFunctions;
+	}
+
+	void Rasterize(olcConsoleGameEngine& engine, const std::vector<triangle>& tris)
+	{
+		if (m_pool.ThreadCount() == 1)
+		{
+			for (auto& t : tris)
+				Fill(engine, t, 0, 0, engine.ScreenWidth(), engine.ScreenHeight());
+			return;
+		}
+
+		int nScreenW = engine.ScreenWidth();
+		int nScreenH = engine.ScreenHeight();
+		int nTilesX = (nScreenW + m_nTileWidth - 1) / m_nTileWidth;
+		int nTilesY = (nScreenH + m_nTileHeight - 1) / m_nTileHeight;
+
+		// Bins keep their capacity from frame to frame
+		m_vecBins.resize(nTilesX * nTilesY);
+		for (auto& bin : m_vecBins)
+			bin.clear();
+
+		for (uint32_t i = 0; i < (uint32_t)tris.size(); i++)
+		{
+			// Rounded down like the rasterizer, so the box covers every cell it can touch
+			const triangle& t = tris[i];
+			int x0 = (int)floorf(t.p[0].x), x1 = (int)floorf(t.p[1].x), x2 = (int)floorf(t.p[2].x);
+			int y0 = (int)floorf(t.p[0].y), y1 = (int)floorf(t.p[1].y), y2 = (int)floorf(t.p[2].y);
+			int minx = std::max(std::min(x0, std::min(x1, x2)), 0);
+			int maxx = std::min(std::max(x0, std::max(x1, x2)), nScreenW - 1);
+			int miny = std::max(std::min(y0, std::min(y1, y2)), 0);
+			int maxy = std::min(std::max(y0, std::max(y1, y2)), nScreenH - 1);
+			if (minx > maxx || miny > maxy)
+				continue;
+
+			for (int ty = miny / m_nTileHeight; ty <= maxy / m_nTileHeight; ty++)
+				for (int tx = minx / m_nTileWidth; tx <= maxx / m_nTileWidth; tx++)
+					m_vecBins[ty * nTilesX + tx].push_back(i);
+		}
+
+		m_pool.ParallelFor(m_vecBins.size(), [&](size_t nTile)
+		{
+			int sx = (int)(nTile % nTilesX) * m_nTileWidth;
+			int sy = (int)(nTile / nTilesX) * m_nTileHeight;
+			for (uint32_t i : m_vecBins[nTile])
+				Fill(engine, tris[i], sx, sy, sx + m_nTileWidth, sy + m_nTileHeight);
+		});
+	}
+
+private:
+	void Fill(olcConsoleGameEngine& engine, const triangle& t, int sx1, int sy1, int sx2, int sy2)
+	{
+		if (m_bEdgeFunctions)
+			engine.FillTriangleDepthEdgeScissored(t.p[0].x, t.p[0].y, t.p[0].w, t.p[1].x, t.p[1].y, t.p[1].w, t.p[2].x, t.p[2].y, t.p[2].w,
+				t.sym, t.col, sx1, sy1, sx2, sy2);
+		else
+			engine.FillTriangleDepthScissored(t.p[0].x, t.p[0].y, t.p[0].w, t.p[1].x, t.p[1].y, t.p[1].w, t.p[2].x, t.p[2].y, t.p[2].w,
+				t.sym, t.col, sx1, sy1, sx2, sy2);
+	}
+
+	workerPool& m_pool;
+	int m_nTileWidth;
+	int m_nTileHeight;
+	bool m_bEdgeFunctions = false;
+	std::vector<std::vector<uint32_t>> m_vecBins;
+};
+
+#endif
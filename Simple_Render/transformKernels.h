@@ -0,0 +1,213 @@
+#pragma once
+
+#ifndef TRANSFORM_KERNELS_H
+#define TRANSFORM_KERNELS_H
+
+#include "utils.h"
+
+// Batch vertex transforms. A kernel pushes n structure-of-arrays positions (w = 1)
+// through a row-vector mat4x4, the same maths as MultiplyVectorMatrix. The SIMD
+// kernels use separate multiplies and adds in the same order as the scalar one, so
+// every kernel returns bit-identical results and the picture does not depend on
+// which one the CPU ended up with.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TRANSFORM_KERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TK_TARGET_SSE
+#define TK_TARGET_AVX
+#else
+#include <cpuid.h>
+#define TK_TARGET_SSE __attribute__((target("sse2")))
+#define TK_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+enum TRANSFORM_KERNEL
+{
+	TRANSFORM_SCALAR,
+	TRANSFORM_SSE,
+	TRANSFORM_AVX,
+};
+
+typedef void (*TransformKernelFn)(const float* x, const float* y, const float* z, size_t n, const mat4x4& m,
+	float* ox, float* oy, float* oz, float* ow);
+
+// ow may be nullptr when the matrix is affine and w is not wanted
+void TransformKernelScalar(const float* x, const float* y, const float* z, size_t n, const mat4x4& m,
+	float* ox, float* oy, float* oz, float* ow)
+{
+	for (size_t v = 0; v < n; v++)
+	{
+		float vx = x[v], vy = y[v], vz = z[v];
+		ox[v] = vx * m.m[0][0] + vy * m.m[1][0] + vz * m.m[2][0] + m.m[3][0];
+		oy[v] = vx * m.m[0][1] + vy * m.m[1][1] + vz * m.m[2][1] + m.m[3][1];
+		oz[v] = vx * m.m[0][2] + vy * m.m[1][2] + vz * m.m[2][2] + m.m[3][2];
+		if (ow)
+			ow[v] = vx * m.m[0][3] + vy * m.m[1][3] + vz * m.m[2][3] + m.m[3][3];
+	}
+}
+
+#ifdef TRANSFORM_KERNELS_X86
+
+TK_TARGET_SSE void TransformKernelSSE(const float* x, const float* y, const float* z, size_t n, const mat4x4& m,
+	float* ox, float* oy, float* oz, float* ow)
+{
+	size_t nBlocks = n & ~(size_t)3;
+	int nColumns = ow ? 4 : 3;
+	float* out[4] = { ox, oy, oz, ow };
+
+	for (int c = 0; c < nColumns; c++)
+	{
+		__m128 m0 = _mm_set1_ps(m.m[0][c]);
+		__m128 m1 = _mm_set1_ps(m.m[1][c]);
+		__m128 m2 = _mm_set1_ps(m.m[2][c]);
+		__m128 m3 = _mm_set1_ps(m.m[3][c]);
+		float* o = out[c];
+
+		for (size_t v = 0; v < nBlocks; v += 4)
+		{
+			__m128 r = _mm_mul_ps(_mm_loadu_ps(x + v), m0);
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(y + v), m1));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(z + v), m2));
+			r = _mm_add_ps(r, m3);
+			_mm_storeu_ps(o + v, r);
+		}
+	}
+
+	TransformKernelScalar(x + nBlocks, y + nBlocks, z + nBlocks, n - nBlocks, m,
+		ox + nBlocks, oy + nBlocks, oz + nBlocks, ow ? ow + nBlocks : nullptr);
+}
+
+TK_TARGET_AVX void TransformKernelAVX(const float* x, const float* y, const float* z, size_t n, const mat4x4& m,
+	float* ox, float* oy, float* oz, float* ow)
+{
+	size_t nBlocks = n & ~(size_t)7;
+	int nColumns = ow ? 4 : 3;
+	float* out[4] = { ox, oy, oz, ow };
+
+	for (int c = 0; c < nColumns; c++)
+	{
+		__m256 m0 = _mm256_set1_ps(m.m[0][c]);
+		__m256 m1 = _mm256_set1_ps(m.m[1][c]);
+		__m256 m2 = _mm256_set1_ps(m.m[2][c]);
+		__m256 m3 = _mm256_set1_ps(m.m[3][c]);
+		float* o = out[c];
+
+		for (size_t v = 0; v < nBlocks; v += 8)
+		{
+			__m256 r = _mm256_mul_ps(_mm256_loadu_ps(x + v), m0);
+			r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_loadu_ps(y + v), m1));
+			r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_loadu_ps(z + v), m2));
+			r = _mm256_add_ps(r, m3);
+			_mm256_storeu_ps(o + v, r);
+		}
+	}
+
+	TransformKernelScalar(x + nBlocks, y + nBlocks, z + nBlocks, n - nBlocks, m,
+		ox + nBlocks, oy + nBlocks, oz + nBlocks, ow ? ow + nBlocks : nullptr);
+}
+
+#endif
+
+// Widest kernel both the CPU and the OS (saved YMM state) support
+TRANSFORM_KERNEL GetBestTransformKernel()
+{
+#ifdef TRANSFORM_KERNELS_X86
+	unsigned int ecx = 0, edx = 0;
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	ecx = (unsigned int)info[2];
+	edx = (unsigned int)info[3];
+#else
+	unsigned int eax, ebx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return TRANSFORM_SCALAR;
+#endif
+
+	bool bSSE2 = (edx & (1u << 26)) != 0;
+	bool bOSXSAVE = (ecx & (1u << 27)) != 0;
+	bool bAVX = (ecx & (1u << 28)) != 0;
+
+	if (bAVX && bOSXSAVE)
+	{
+#ifdef _MSC_VER
+		unsigned long long xcr0 = _xgetbv(0);
+#else
+		unsigned int lo, hi;
+		__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+		unsigned long long xcr0 = ((unsigned long long)hi << 32) | lo;
+#endif
+		if ((xcr0 & 6) == 6)
+			return TRANSFORM_AVX;
+	}
+
+	if (bSSE2)
+		return TRANSFORM_SSE;
+#endif
+	return TRANSFORM_SCALAR;
+}
+
+const wchar_t* GetTransformKernelName(TRANSFORM_KERNEL k)
+{
+	switch (k)
+	{
+	case TRANSFORM_SSE: return L"SSE";
+	case TRANSFORM_AVX: return L"AVX";
+	default: return L"Scalar";
+	}
+}
+
+// The kernel in use, picked by CPUID on first use unless overridden
+TRANSFORM_KERNEL& ActiveTransformKernel()
+{
+	static TRANSFORM_KERNEL k = GetBestTransformKernel();
+	return k;
+}
+
+// Force a kernel, e.g. to compare them. Requests the CPU cannot run fall back to the best available
+void SetTransformKernel(TRANSFORM_KERNEL k)
+{
+	TRANSFORM_KERNEL best = GetBestTransformKernel();
+	ActiveTransformKernel() = k > best ? best : k;
+}
+
+TransformKernelFn GetTransformKernelFn(TRANSFORM_KERNEL k)
+{
+#ifdef TRANSFORM_KERNELS_X86
+	if (k == TRANSFORM_AVX) return TransformKernelAVX;
+	if (k == TRANSFORM_SSE) return TransformKernelSSE;
+#endif
+	return TransformKernelScalar;
+}
+
+// Transforms every vertex of i into o. If w is given the fourth column is
+// computed too, as needed for a projection matrix.
+void TransformVertices(const vertexArrays& i, vertexArrays& o, const mat4x4& m, std::vector<float>* w = nullptr)
+{
+	size_t n = i.size();
+	o.resize(n);
+	if (w)
+		w->resize(n);
+	if (n == 0)
+		return;
+
+	GetTransformKernelFn(ActiveTransformKernel())(i.x.data(), i.y.data(), i.z.data(), n, m,
+		o.x.data(), o.y.data(), o.z.data(), w ? w->data() : nullptr);
+}
+
+// Transforms vertices [nFirst, nFirst + nCount) of i into the same slots of o,
+// which must already be as large as i (and w too, if given)
+void TransformVertexRange(const vertexArrays& i, vertexArrays& o, size_t nFirst, size_t nCount, const mat4x4& m, std::vector<float>* w = nullptr)
+{
+	if (nCount == 0)
+		return;
+
+	GetTransformKernelFn(ActiveTransformKernel())(i.x.data() + nFirst, i.y.data() + nFirst, i.z.data() + nFirst, nCount, m,
+		o.x.data() + nFirst, o.y.data() + nFirst, o.z.data() + nFirst, w ? w->data() + nFirst : nullptr);
+}
+
+#endif
@@ -3,8 +3,16 @@
 #ifndef UTILS_H
 #define UTILS_H
 
-#include <fstream>
-#include <strstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <tuple>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <cmath>
+
+#include "mappedFile.h"
 
 struct vec3d // 3D vector
 {
@@ -68,45 +76,304 @@ struct triangle // Simple triangle containing exactly 3 3D vectors
 	short col;
 };
 
-struct mesh // Object containing a vector of triangles
+struct vertexArrays // Vertex positions stored as separate x, y and z arrays
 {
-	std::vector<triangle> tris;
+	std::vector<float> x, y, z;
 
-	bool LoadFromObjFile(std::string sFilename)
+	size_t size() const { return x.size(); }
+
+	void resize(size_t n)
 	{
-		std::ifstream f(sFilename);
-		if (!f.is_open())
-			return false;
+		x.resize(n);
+		y.resize(n);
+		z.resize(n);
+	}
 
-		// Local cache of verts
-		std::vector<vec3d> verts;
+	void push_back(float vx, float vy, float vz)
+	{
+		x.push_back(vx);
+		y.push_back(vy);
+		z.push_back(vz);
+	}
 
-		while (!f.eof())
-		{
-			char line[128];
-			f.getline(line, 128);
+	vec3d Get(uint32_t i) const
+	{
+		vec3d v;
+		v.x = x[i];
+		v.y = y[i];
+		v.z = z[i];
+		v.w = 1.0f;
+		return v;
+	}
+};
 
-			std::strstream s;
-			s << line;
+// What an .obj load did and how fast. bFromCache is set by LoadObjFileCached.
+struct objLoadStats
+{
+	size_t nBytes = 0;
+	size_t nVertices = 0;
+	size_t nFaces = 0;
+	size_t nTriangles = 0;
+	size_t nSkippedFaces = 0; // faces referring to vertices that do not exist
+	size_t nChunks = 1; // pieces the file was parsed in, 1 when it was read on one thread
+	double dSeconds = 0.0;
+	bool bFromCache = false;
+
+	double MBPerSecond() const { return dSeconds > 0.0 ? (double)nBytes / (1024.0 * 1024.0) / dSeconds : 0.0; }
+};
+
+// Hand rolled number parsing for the .obj loader. Both skip leading blanks and
+// return where they stopped, or nullptr if there was no number.
+const char* ParseObjFloat(const char* p, const char* end, float& out)
+{
+	static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
 
-			char junk;
+	while (p < end && (*p == ' ' || *p == '\t'))
+		p++;
 
-			if (line[0] == 'v')
+	bool bNegative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		bNegative = *p++ == '-';
+
+	// Up to 19 significant digits fit in the mantissa, further ones only scale it
+	uint64_t nMantissa = 0;
+	int nDigits = 0, nExponent = 0;
+	const char* pStart = p;
+	for (; p < end && *p >= '0' && *p <= '9'; p++)
+	{
+		if (nDigits < 19)
+		{
+			nMantissa = nMantissa * 10 + (*p - '0');
+			if (nMantissa) nDigits++;
+		}
+		else
+			nExponent++;
+	}
+	if (p < end && *p == '.')
+	{
+		for (p++; p < end && *p >= '0' && *p <= '9'; p++)
+		{
+			if (nDigits < 19)
 			{
-				vec3d v;
-				s >> junk >> v.x >> v.y >> v.z;
-				verts.push_back(v);
+				nMantissa = nMantissa * 10 + (*p - '0');
+				if (nMantissa) nDigits++;
+				nExponent--;
 			}
+		}
+	}
+	if (p == pStart || (p == pStart + 1 && *pStart == '.'))
+		return nullptr;
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		const char* pExp = p + 1;
+		bool bNegativeExp = false;
+		if (pExp < end && (*pExp == '-' || *pExp == '+'))
+			bNegativeExp = *pExp++ == '-';
+		if (pExp < end && *pExp >= '0' && *pExp <= '9')
+		{
+			int e = 0;
+			for (; pExp < end && *pExp >= '0' && *pExp <= '9'; pExp++)
+				if (e < 10000) e = e * 10 + (*pExp - '0');
+			nExponent += bNegativeExp ? -e : e;
+			p = pExp;
+		}
+	}
+
+	// Powers of ten up to 22 are exact in a double, so this rounds correctly for typical inputs
+	double v = (double)nMantissa;
+	if (nExponent < 0)
+		v = -nExponent <= 22 ? v / pow10[-nExponent] : v * pow(10.0, nExponent);
+	else if (nExponent > 0)
+		v = nExponent <= 22 ? v * pow10[nExponent] : v * pow(10.0, nExponent);
+
+	out = (float)(bNegative ? -v : v);
+	return p;
+}
 
-			if (line[0] == 'f')
+const char* ParseObjInt(const char* p, const char* end, int64_t& out)
+{
+	while (p < end && (*p == ' ' || *p == '\t'))
+		p++;
+
+	bool bNegative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		bNegative = *p++ == '-';
+
+	if (p == end || *p < '0' || *p > '9')
+		return nullptr;
+
+	int64_t n = 0;
+	for (; p < end && *p >= '0' && *p <= '9'; p++)
+		n = n * 10 + (*p - '0');
+	out = bNegative ? -n : n;
+	return p;
+}
+
+struct indexedMesh // Every vertex stored once, triangles refer to them by index
+{
+	vertexArrays verts;
+	std::vector<uint32_t> indices; // 3 per triangle
+	vertexArrays normals; // One unit face normal per triangle once ComputeFaceNormals has run
+
+	size_t TriangleCount() const { return indices.size() / 3; }
+
+	// Same normal GetTriangleNormal gives, worked out once instead of every frame.
+	// Degenerate triangles get a zero normal, which every backface test rejects.
+	void ComputeFaceNormals()
+	{
+		size_t nTriangles = TriangleCount();
+		normals.resize(nTriangles);
+		for (size_t t = 0; t < nTriangles; t++)
+		{
+			vec3d p0 = verts.Get(indices[t * 3]), p1 = verts.Get(indices[t * 3 + 1]), p2 = verts.Get(indices[t * 3 + 2]);
+			vec3d line1 = p1 - p0, line2 = p2 - p0;
+			float nx = line1.y * line2.z - line1.z * line2.y;
+			float ny = line1.z * line2.x - line1.x * line2.z;
+			float nz = line1.x * line2.y - line1.y * line2.x;
+			float l = sqrtf(nx * nx + ny * ny + nz * nz);
+			float fInvLength = l > 0.0f ? 1.0f / l : 0.0f;
+			normals.x[t] = nx * fInvLength;
+			normals.y[t] = ny * fInvLength;
+			normals.z[t] = nz * fInvLength;
+		}
+	}
+
+	// Memory maps the file and parses it in place. Understands v, and f with any
+	// of the a, a/b, a//c and a/b/c forms, negative (relative) indices and
+	// polygons, which are split into a fan. Everything else (vt, vn, o, g, s,
+	// usemtl, comments...) is skipped.
+	bool LoadFromObjFile(std::string sFilename, objLoadStats* pStats = nullptr)
+	{
+		auto tpStart = std::chrono::steady_clock::now();
+
+		mappedFile file;
+		if (!file.Open(sFilename))
+			return false;
+
+		objLoadStats stats;
+		stats.nBytes = file.Size();
+		size_t nFirstVertex = verts.size();
+
+		// Rough guesses from the file size save most of the regrowing
+		verts.x.reserve(verts.size() + file.Size() / 80);
+		verts.y.reserve(verts.size() + file.Size() / 80);
+		verts.z.reserve(verts.size() + file.Size() / 80);
+		indices.reserve(indices.size() + file.Size() / 12);
+
+		ParseObj(file.Data(), file.Data() + file.Size(), nFirstVertex, stats);
+
+		stats.dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tpStart).count();
+		if (pStats)
+			*pStats = stats;
+		return true;
+	};
+
+	// Parses .obj text in [p, end). Vertex indices in faces are relative to
+	// nFirstVertex, the number of vertices the mesh had before this file.
+	void ParseObj(const char* p, const char* end, size_t nFirstVertex, objLoadStats& stats)
+	{
+		std::vector<uint32_t> vecPolygon;
+
+		while (p < end)
+		{
+			while (p < end && (*p == ' ' || *p == '\t'))
+				p++;
+
+			const char* pLineEnd = (const char*)memchr(p, '\n', end - p);
+			if (pLineEnd == nullptr)
+				pLineEnd = end;
+
+			if (pLineEnd - p >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
 			{
-				int f[3];
-				s >> junk >> f[0] >> f[1] >> f[2];
-				tris.push_back({ verts[f[0] - 1], verts[f[1] - 1], verts[f[2] - 1] });
+				float x = 0.0f, y = 0.0f, z = 0.0f;
+				const char* q = ParseObjFloat(p + 2, pLineEnd, x);
+				if (q) q = ParseObjFloat(q, pLineEnd, y);
+				if (q) q = ParseObjFloat(q, pLineEnd, z);
+				verts.push_back(x, y, z);
+				stats.nVertices++;
 			}
+			else if (pLineEnd - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+			{
+				vecPolygon.clear();
+				bool bValid = true;
+				size_t nVertexCount = verts.size() - nFirstVertex;
+
+				const char* q = p + 2;
+				int64_t n;
+				while ((q = ParseObjInt(q, pLineEnd, n)) != nullptr)
+				{
+					// 1 based, or counting back from the latest vertex when negative
+					int64_t nIndex = n > 0 ? n - 1 : (int64_t)nVertexCount + n;
+					if (n == 0 || nIndex < 0 || nIndex >= (int64_t)nVertexCount)
+						bValid = false;
+					vecPolygon.push_back((uint32_t)(nFirstVertex + nIndex));
+
+					// Skip the texture and normal indices, we only need positions
+					while (q < pLineEnd && *q != ' ' && *q != '\t' && *q != '\r')
+						q++;
+				}
+
+				stats.nFaces++;
+				if (!bValid || vecPolygon.size() < 3)
+					stats.nSkippedFaces++;
+				else
+				{
+					for (size_t k = 1; k + 1 < vecPolygon.size(); k++)
+					{
+						indices.push_back(vecPolygon[0]);
+						indices.push_back(vecPolygon[k]);
+						indices.push_back(vecPolygon[k + 1]);
+						stats.nTriangles++;
+					}
+				}
+			}
+
+			p = pLineEnd + 1;
 		}
+	}
+};
+
+struct mesh // Object containing a vector of triangles
+{
+	std::vector<triangle> tris;
+
+	bool LoadFromObjFile(std::string sFilename, objLoadStats* pStats = nullptr)
+	{
+		indexedMesh m;
+		if (!m.LoadFromObjFile(sFilename, pStats))
+			return false;
+
+		tris.reserve(tris.size() + m.TriangleCount());
+		for (size_t i = 0; i < m.indices.size(); i += 3)
+			tris.push_back({ m.verts.Get(m.indices[i]), m.verts.Get(m.indices[i + 1]), m.verts.Get(m.indices[i + 2]) });
 		return true;
 	};
+
+	// Welds identical positions together into an indexed mesh
+	indexedMesh ToIndexed() const
+	{
+		indexedMesh m;
+		std::map<std::tuple<float, float, float>, uint32_t> mapVerts;
+		m.indices.reserve(tris.size() * 3);
+
+		for (auto& t : tris)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				auto key = std::make_tuple(t.p[k].x, t.p[k].y, t.p[k].z);
+				auto it = mapVerts.find(key);
+				if (it == mapVerts.end())
+				{
+					it = mapVerts.emplace(key, (uint32_t)m.verts.size()).first;
+					m.verts.push_back(t.p[k].x, t.p[k].y, t.p[k].z);
+				}
+				m.indices.push_back(it->second);
+			}
+		}
+		return m;
+	}
 };
 
 struct mat4x4 //4x4 Matrix
@@ -168,6 +435,15 @@ void MultiplyVectorMatrix(vec3d& i, vec3d& o, mat4x4& m)
 	o.w = i.x * m.m[0][3] + i.y * m.m[1][3] + i.z * m.m[2][3] + m.m[3][3];
 }
 
+// Rotates a direction, the translation part of the matrix is ignored
+void MultiplyDirectionMatrix(vec3d& i, vec3d& o, mat4x4& m)
+{
+	o.x = i.x * m.m[0][0] + i.y * m.m[1][0] + i.z * m.m[2][0];
+	o.y = i.x * m.m[0][1] + i.y * m.m[1][1] + i.z * m.m[2][1];
+	o.z = i.x * m.m[0][2] + i.y * m.m[1][2] + i.z * m.m[2][2];
+	o.w = 0.0f;
+}
+
 mat4x4 CreateIdentityMatrix()
 {
 	mat4x4 matrix;
@@ -345,7 +621,11 @@ vec3d Vector_IntersectPlane(vec3d& plane_p, vec3d& plane_n, vec3d& lineStart, ve
 	float t = (-plane_d - ad) / (bd - ad);
 	vec3d lineStartToEnd = lineEnd - lineStart;
 	vec3d lineToIntersect = lineStartToEnd * t;
-	return lineStart + lineToIntersect;
+	vec3d intersect = lineStart + lineToIntersect;
+
+	// w is carried along so that screen space vertices keep their 1/w for depth testing
+	intersect.w = lineStart.w + (lineEnd.w - lineStart.w) * t;
+	return intersect;
 }
 
 int Triangle_ClipAgainstPlane(vec3d plane_p, vec3d plane_n, triangle& in_tri, triangle& out_tri1, triangle& out_tri2)
@@ -453,6 +733,95 @@ int Triangle_ClipAgainstPlane(vec3d plane_p, vec3d plane_n, triangle& in_tri, tr
 	}
 }
 
+// Fixed capacity FIFO of triangles that lives on the stack
+template <int N>
+struct triangleRing
+{
+	triangle items[N];
+	int nHead = 0;
+	int nCount = 0;
+
+	void push_back(const triangle& t)
+	{
+		items[(nHead + nCount) % N] = t;
+		nCount++;
+	}
+
+	triangle& front() { return items[nHead]; }
+
+	void pop_front()
+	{
+		nHead = (nHead + 1) % N;
+		nCount--;
+	}
+
+	int size() const { return nCount; }
+};
+
+// Most triangles a screen space triangle can turn into after Triangle_ClipAgainstScreen
+const int nMaxScreenClippedTriangles = 16;
+
+// Clips a screen space triangle against the four screen edges into out, returning
+// how many triangles came out. Each plane can at most double the count, so 16
+// slots always suffice and nothing touches the heap. Triangles whose bounding box
+// is already on screen are passed straight through.
+//
+// With a guard band the edges are pushed out by fGuardBand cells on every side:
+// triangles overhanging the screen by less than that are left whole for the
+// rasterizer to scissor, and only the rare larger ones get cut up.
+int Triangle_ClipAgainstScreen(triangle& in_tri, float fWidth, float fHeight, triangle (&out_tris)[nMaxScreenClippedTriangles], float fGuardBand = 0.0f)
+{
+	float fLeft = -fGuardBand;
+	float fTop = -fGuardBand;
+	float fRight = fWidth - 1.0f + fGuardBand;
+	float fBottom = fHeight - 1.0f + fGuardBand;
+
+	bool bInside = true;
+	for (int k = 0; k < 3; k++)
+		bInside = bInside && in_tri.p[k].x >= fLeft && in_tri.p[k].x <= fRight && in_tri.p[k].y >= fTop && in_tri.p[k].y <= fBottom;
+
+	if (bInside)
+	{
+		out_tris[0] = in_tri;
+		return 1;
+	}
+
+	triangleRing<nMaxScreenClippedTriangles> ring;
+	ring.push_back(in_tri);
+
+	triangle clipped[2];
+	for (int p = 0; p < 4; p++)
+	{
+		// Only the triangles produced by the previous plane are tested against this one
+		int nToTest = ring.size();
+		while (nToTest-- > 0)
+		{
+			triangle test = ring.front();
+			ring.pop_front();
+
+			int nTrisToAdd = 0;
+			switch (p)
+			{
+			case 0:	nTrisToAdd = Triangle_ClipAgainstPlane({ 0.0f, fTop, 0.0f }, { 0.0f, 1.0f, 0.0f }, test, clipped[0], clipped[1]); break;
+			case 1:	nTrisToAdd = Triangle_ClipAgainstPlane({ 0.0f, fBottom, 0.0f }, { 0.0f, -1.0f, 0.0f }, test, clipped[0], clipped[1]); break;
+			case 2:	nTrisToAdd = Triangle_ClipAgainstPlane({ fLeft, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, test, clipped[0], clipped[1]); break;
+			case 3:	nTrisToAdd = Triangle_ClipAgainstPlane({ fRight, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, test, clipped[0], clipped[1]); break;
+			}
+
+			for (int w = 0; w < nTrisToAdd; w++)
+				ring.push_back(clipped[w]);
+		}
+	}
+
+	int nCount = ring.size();
+	for (int n = 0; n < nCount; n++)
+	{
+		out_tris[n] = ring.front();
+		ring.pop_front();
+	}
+	return nCount;
+}
+
 mat4x4 ComputeQuickInverse(mat4x4& m) // Works only for Rotation and Translation Matrices and our Camera matrix
 {
 	mat4x4 matrix;
@@ -497,6 +866,34 @@ mesh CreateCuboidMesh(vec3d& origin, vec3d& size)
 	return m;
 }
 
+// Rolling hills of nCells by nCells squares, two triangles each, fSize units
+// across and centred on the origin, no higher than fHeight. The same mesh comes
+// out every time, for benchmarks that need terrain of a given size.
+indexedMesh CreateTerrainMesh(int nCells, float fSize, float fHeight)
+{
+	indexedMesh m;
+	int nSide = nCells + 1;
+	float fStep = fSize / nCells;
+	for (int j = 0; j < nSide; j++)
+		for (int i = 0; i < nSide; i++)
+		{
+			float x = -0.5f * fSize + i * fStep;
+			float z = -0.5f * fSize + j * fStep;
+			float u = x / fSize, v = z / fSize;
+			float h = 0.5f + 0.25f * sinf(9.0f * u) * cosf(7.0f * v) + 0.15f * sinf(23.0f * u + 17.0f * v) + 0.1f * cosf(41.0f * v - 29.0f * u);
+			m.verts.push_back(x, fHeight * h, z);
+		}
+
+	// Wound so the faces point up
+	for (int j = 0; j < nCells; j++)
+		for (int i = 0; i < nCells; i++)
+		{
+			uint32_t n00 = j * nSide + i, n10 = n00 + 1, n01 = n00 + nSide, n11 = n01 + 1;
+			m.indices.insert(m.indices.end(), { n00, n01, n10, n10, n01, n11 });
+		}
+	return m;
+}
+
 void ScaleToScreenSize(triangle& v, float width, float height)
 {
 	vec3d vOffsetView = { 1.0f, 1.0f, 0.0f };
@@ -0,0 +1,143 @@
+#pragma once
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// A fixed set of threads that sleep until handed a ParallelFor. Items are pulled
+// off a shared atomic counter so uneven work balances itself, and the calling
+// thread works too. Nothing is allocated per job.
+class workerPool
+{
+public:
+	// nThreads counts the caller, 0 means one per hardware thread
+	workerPool(int nThreads = 0)
+	{
+		Resize(nThreads);
+	}
+
+	~workerPool()
+	{
+		Stop();
+	}
+
+	void Resize(int nThreads)
+	{
+		if (nThreads <= 0)
+			nThreads = (int)std::thread::hardware_concurrency();
+		if (nThreads <= 0)
+			nThreads = 1;
+
+		Stop();
+
+		// New threads only wait for jobs handed out after they were started
+		uint64_t nGeneration;
+		{
+			std::unique_lock<std::mutex> lm(m_mux);
+			m_bStop = false;
+			nGeneration = m_nGeneration;
+		}
+		m_nThreads = nThreads;
+		for (int t = 1; t < nThreads; t++)
+			m_vecThreads.emplace_back(&workerPool::WorkerThread, this, nGeneration);
+	}
+
+	int ThreadCount() const { return m_nThreads; }
+
+	// Calls fn(i) for every i in [0, n) and returns once all calls have finished
+	template <typename F>
+	void ParallelFor(size_t n, F fn)
+	{
+		if (n == 0)
+			return;
+
+		if (m_nThreads == 1 || n == 1)
+		{
+			for (size_t i = 0; i < n; i++)
+				fn(i);
+			return;
+		}
+
+		{
+			std::unique_lock<std::mutex> lm(m_mux);
+			m_pJob = &fn;
+			m_pJobCall = [](void* job, size_t i) { (*(F*)job)(i); };
+			m_nJobSize = n;
+			m_nNext = 0;
+			m_nBusy = (int)m_vecThreads.size();
+			m_nGeneration++;
+		}
+		m_cvWork.notify_all();
+
+		RunItems();
+
+		std::unique_lock<std::mutex> lm(m_mux);
+		while (m_nBusy > 0)
+			m_cvDone.wait(lm);
+		m_pJob = nullptr;
+	}
+
+private:
+	void RunItems()
+	{
+		size_t i;
+		while ((i = m_nNext.fetch_add(1)) < m_nJobSize)
+			m_pJobCall(m_pJob, i);
+	}
+
+	void WorkerThread(uint64_t nSeen)
+	{
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lm(m_mux);
+				while (!m_bStop && m_nGeneration == nSeen)
+					m_cvWork.wait(lm);
+				if (m_bStop)
+					return;
+				nSeen = m_nGeneration;
+			}
+
+			RunItems();
+
+			std::unique_lock<std::mutex> lm(m_mux);
+			if (--m_nBusy == 0)
+				m_cvDone.notify_one();
+		}
+	}
+
+	void Stop()
+	{
+		{
+			std::unique_lock<std::mutex> lm(m_mux);
+			m_bStop = true;
+		}
+		m_cvWork.notify_all();
+		for (auto& t : m_vecThreads)
+			t.join();
+		m_vecThreads.clear();
+	}
+
+	int m_nThreads = 1;
+	std::vector<std::thread> m_vecThreads;
+	std::mutex m_mux;
+	std::condition_variable m_cvWork;
+	std::condition_variable m_cvDone;
+	bool m_bStop = false;
+	uint64_t m_nGeneration = 0;
+	int m_nBusy = 0;
+
+	void* m_pJob = nullptr;
+	void (*m_pJobCall)(void*, size_t) = nullptr;
+	size_t m_nJobSize = 0;
+	std::atomic<size_t> m_nNext{ 0 };
+};
+
+#endif